@@ -18,6 +18,12 @@ CONFIG += c++11
 
 INCLUDEPATH += $$PWD/src $$PWD/include
 
+# color_utils_batch_avx2.cpp needs AVX2 enabled for that file only, which qmake
+# can't do per source. Here it's built with the default flags and provides no
+# kernels, so the batch conversions use SSE2 or NEON. Don't add -mavx2 to
+# QMAKE_CXXFLAGS: the whole library would then require an AVX2 CPU.
+# The CMake build enables the AVX2 kernels.
+
 SOURCES += \
     $$PWD/src/QtColorWidgets/abstract_widget_list.cpp \
     $$PWD/src/QtColorWidgets/bound_color_selector.cpp \
@@ -33,6 +39,8 @@ SOURCES += \
     $$PWD/src/QtColorWidgets/color_preview.cpp \
     $$PWD/src/QtColorWidgets/color_selector.cpp \
     $$PWD/src/QtColorWidgets/color_utils.cpp \
+    $$PWD/src/QtColorWidgets/color_utils_batch.cpp \
+    $$PWD/src/QtColorWidgets/color_utils_batch_avx2.cpp \
     $$PWD/src/QtColorWidgets/color_wheel.cpp \
     $$PWD/src/QtColorWidgets/gradient_editor.cpp \
     $$PWD/src/QtColorWidgets/gradient_list_model.cpp \
@@ -43,6 +51,7 @@ SOURCES += \
 
 HEADERS += \
     $$PWD/include/QtColorWidgets/abstract_widget_list.hpp \
+    $$PWD/include/QtColorWidgets/binary_palette_private.hpp \
     $$PWD/include/QtColorWidgets/bound_color_selector.hpp \
     $$PWD/include/QtColorWidgets/color_2d_slider.hpp \
     $$PWD/include/QtColorWidgets/color_delegate.hpp \
@@ -55,10 +64,12 @@ HEADERS += \
     $$PWD/include/QtColorWidgets/color_palette_widget.hpp \
     $$PWD/include/QtColorWidgets/color_preview.hpp \
     $$PWD/include/QtColorWidgets/color_selector.hpp \
+    $$PWD/include/QtColorWidgets/color_space_private.hpp \
     $$PWD/include/QtColorWidgets/color_utils.hpp \
     $$PWD/include/QtColorWidgets/color_wheel.hpp \
     $$PWD/include/QtColorWidgets/color_wheel_private.hpp \
     $$PWD/include/QtColorWidgets/colorwidgets_global.hpp \
+    $$PWD/include/QtColorWidgets/gpl_parser_private.hpp \
     $$PWD/include/QtColorWidgets/gradient_delegate.hpp \
     $$PWD/include/QtColorWidgets/gradient_editor.hpp \
     $$PWD/include/QtColorWidgets/gradient_helper.hpp \
@@ -66,6 +77,10 @@ HEADERS += \
     $$PWD/include/QtColorWidgets/gradient_slider.hpp \
     $$PWD/include/QtColorWidgets/harmony_color_wheel.hpp \
     $$PWD/include/QtColorWidgets/hue_slider.hpp \
+    $$PWD/include/QtColorWidgets/oklab_private.hpp \
+    $$PWD/include/QtColorWidgets/palette_file_private.hpp \
+    $$PWD/include/QtColorWidgets/rgba.hpp \
+    $$PWD/include/QtColorWidgets/srgb_tables_private.hpp \
     $$PWD/include/QtColorWidgets/swatch.hpp
 
 FORMS += \
@@ -0,0 +1,231 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_BINARY_PALETTE_PRIVATE_HPP
+#define COLOR_WIDGETS_BINARY_PALETTE_PRIVATE_HPP
+
+#include <cstring>
+#include <QByteArray>
+#include <QColor>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QtEndian>
+
+namespace color_widgets {
+
+/*
+ * Binary palette files, all integers are little endian:
+ *
+ *  - Header: the magic bytes "QCPL", quint16 version, quint16 flags (0),
+ *    then quint32 columns, color count, name size and string table size
+ *  - Palette name in UTF-8, padded with zeros to a multiple of 4 bytes
+ *  - Colors as QRgb, count entries
+ *  - Offsets of the color names in the string table, count + 1 entries
+ *  - String table, the UTF-8 names one after the other
+ *
+ * Sections are aligned so the colors can be read in place from a mapped file.
+ */
+namespace binary_palette {
+
+const char magic[4] = {'Q', 'C', 'P', 'L'};
+const quint16 version = 1;
+const int header_size = 24;
+
+/// Whether \p data starts like a binary palette, it still needs validating
+inline bool matches(const char* data, qint64 size)
+{
+    return size >= 4 && std::memcmp(data, magic, 4) == 0;
+}
+
+inline quint32 read32(const char* data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+inline quint16 read16(const char* data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+}
+
+inline qint64 padded(qint64 size)
+{
+    return (size + 3) & ~qint64(3);
+}
+
+/**
+ * \brief Validated view on a binary palette in memory
+ *
+ * Colors and names point into the data, which must outlive the view.
+ */
+class View
+{
+public:
+    /**
+     * \brief Checks the palette in \p data
+     * \returns \b false if it's truncated or inconsistent, see errorString()
+     */
+    bool open(const char* data, qint64 size)
+    {
+        if ( size < header_size || !matches(data, size) )
+            return fail(QStringLiteral("not a binary palette"));
+        if ( read16(data + 4) != version )
+            return fail(QStringLiteral("unsupported version %1").arg(read16(data + 4)));
+
+        palette_columns = read32(data + 8);
+        color_count = read32(data + 12);
+        quint32 name_size = read32(data + 16);
+        quint32 strings_size = read32(data + 20);
+
+        // Each color takes at least 8 bytes, this also keeps count() within int
+        if ( qint64(color_count) * 8 > size )
+            return fail(QStringLiteral("invalid color count"));
+
+        // 64 bit arithmetic, none of these can overflow with 32 bit fields
+        qint64 colors_offset = header_size + padded(name_size);
+        qint64 offsets_offset = colors_offset + qint64(color_count) * 4;
+        qint64 strings_offset = offsets_offset + (qint64(color_count) + 1) * 4;
+        if ( strings_offset + strings_size > size )
+            return fail(QStringLiteral("truncated file"));
+
+        palette_name = QString::fromUtf8(data + header_size, name_size);
+        color_data = data + colors_offset;
+        offset_data = data + offsets_offset;
+        string_data = data + strings_offset;
+
+        // Offsets must be sorted and within the table, so names can be read unchecked
+        quint32 previous = 0;
+        for ( quint32 i = 0; i <= color_count; i++ )
+        {
+            quint32 offset = read32(offset_data + 4 * i);
+            if ( offset < previous || offset > strings_size )
+                return fail(QStringLiteral("invalid name offset for color %1").arg(i));
+            previous = offset;
+        }
+
+        return true;
+    }
+
+    QString name() const { return palette_name; }
+    int columns() const { return int(qMin<quint32>(palette_columns, 0x7fffffff)); }
+    int count() const { return int(color_count); }
+
+    /**
+     * \brief Colors stored in the file
+     *
+     * On little endian machines they are used in place when the data is
+     * aligned, otherwise they are copied once.
+     */
+    const QRgb* colors()
+    {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        if ( reinterpret_cast<quintptr>(color_data) % alignof(QRgb) == 0 )
+            return reinterpret_cast<const QRgb*>(color_data);
+#endif
+        if ( converted.size() != int(color_count) )
+        {
+            converted.resize(color_count);
+            for ( quint32 i = 0; i < color_count; i++ )
+                converted[i] = read32(color_data + 4 * i);
+        }
+        return converted.data();
+    }
+
+    /// UTF-8 name of the color at \p index, \p size is set to its size in bytes
+    const char* colorName(int index, int& size) const
+    {
+        quint32 begin = read32(offset_data + 4 * index);
+        size = int(read32(offset_data + 4 * index + 4) - begin);
+        return string_data + begin;
+    }
+
+    QString errorString() const { return error_string; }
+
+private:
+    bool fail(const QString& message)
+    {
+        error_string = message;
+        return false;
+    }
+
+    quint32 palette_columns = 0;
+    quint32 color_count = 0;
+    QString palette_name;
+    const char* color_data = nullptr;
+    const char* offset_data = nullptr;
+    const char* string_data = nullptr;
+    QVector<QRgb> converted;
+    QString error_string;
+};
+
+inline void append32(QByteArray& data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+/// Serializes a palette in the binary format
+inline QByteArray write(const QString& name, int columns, const QVector<QPair<QColor, QString>>& colors)
+{
+    QByteArray name_data = name.toUtf8();
+    QVector<QByteArray> names;
+    names.reserve(colors.size());
+    quint32 strings_size = 0;
+    for ( const auto& color : colors )
+    {
+        names.push_back(color.second.toUtf8());
+        strings_size += names.back().size();
+    }
+
+    QByteArray data;
+    data.reserve(header_size + padded(name_data.size()) + colors.size() * 8 + 4 + strings_size);
+    data.append(magic, 4);
+    uchar word[2];
+    qToLittleEndian(version, word);
+    data.append(reinterpret_cast<const char*>(word), 2);
+    data.append(2, '\0');
+    append32(data, quint32(qMax(columns, 0)));
+    append32(data, quint32(colors.size()));
+    append32(data, quint32(name_data.size()));
+    append32(data, strings_size);
+
+    data.append(name_data);
+    data.append(int(padded(name_data.size()) - name_data.size()), '\0');
+
+    for ( const auto& color : colors )
+        append32(data, color.first.rgba());
+
+    quint32 offset = 0;
+    append32(data, offset);
+    for ( const QByteArray& color_name : names )
+        append32(data, offset += color_name.size());
+
+    for ( const QByteArray& color_name : names )
+        data.append(color_name);
+
+    return data;
+}
+
+} // namespace binary_palette
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_BINARY_PALETTE_PRIVATE_HPP
@@ -23,6 +23,7 @@
 #define COLOR_WIDGETS_COLOR_2D_SLIDER_HPP
 
 #include "colorwidgets_global.hpp"
+#include "color_wheel.hpp"
 #include <QWidget>
 
 namespace color_widgets {
@@ -46,6 +47,29 @@ class QCP_EXPORT Color2DSlider : public QWidget
      * \brief Which color component is used on the y axis
      */
     Q_PROPERTY(Component componentY READ componentY WRITE setComponentY NOTIFY componentYChanged)
+    /**
+     * \brief Whether mouse drags are processed at most once per screen refresh
+     *
+     * When enabled, only the latest of the mouse move events received within
+     * a frame is processed, which also limits the rate of colorChanged().
+     * Disable it to process every event.
+     */
+    Q_PROPERTY(bool coalesceInput READ coalesceInput WRITE setCoalesceInput NOTIFY coalesceInputChanged)
+    /**
+     * \brief Color space of the components
+     *
+     * Saturation and Value stand for the second and third component of the
+     * space, eg: chroma and luma for LCH. Colors out of the RGB gamut are
+     * shown as transparent.
+     */
+    Q_PROPERTY(ColorWheel::ColorSpaceEnum colorSpace READ colorSpace WRITE setColorSpace NOTIFY colorSpaceChanged)
+    /**
+     * \brief Milliseconds the size has to be stable before re-rendering
+     *
+     * While the widget is being resized, the images rendered for the
+     * previous size are scaled. 0 re-renders on every resize.
+     */
+    Q_PROPERTY(int resizeDebounce READ resizeDebounce WRITE setResizeDebounce NOTIFY resizeDebounceChanged)
 
 
 public:
@@ -74,6 +98,15 @@ public:
     Component componentX() const;
     Component componentY() const;
 
+    /// Whether mouse drags are processed at most once per screen refresh
+    bool coalesceInput() const;
+
+    /// Color space of the components
+    ColorWheel::ColorSpaceEnum colorSpace() const;
+
+    /// Milliseconds the size has to be stable before re-rendering
+    int resizeDebounce() const;
+
 public Q_SLOTS:
 
     /// Set current color
@@ -97,6 +130,15 @@ public Q_SLOTS:
     void setComponentX(Component componentX);
     void setComponentY(Component componentY);
 
+    /// Sets whether mouse drags are processed at most once per screen refresh
+    void setCoalesceInput(bool coalesce);
+
+    /// Sets the color space of the components
+    void setColorSpace(ColorWheel::ColorSpaceEnum space);
+
+    /// Sets the milliseconds the size has to be stable before re-rendering
+    void setResizeDebounce(int msecs);
+
 Q_SIGNALS:
     /**
      * Emitted when the user selects a color or setColor is called
@@ -110,8 +152,12 @@ Q_SIGNALS:
 
     void componentXChanged(Component componentX);
     void componentYChanged(Component componentY);
+    void coalesceInputChanged(bool coalesce);
+    void colorSpaceChanged(ColorWheel::ColorSpaceEnum space);
+    void resizeDebounceChanged(int msecs);
 
 protected:
+    bool event(QEvent* event) Q_DECL_OVERRIDE;
     void paintEvent(QPaintEvent* event) Q_DECL_OVERRIDE;
     void mousePressEvent(QMouseEvent* event) Q_DECL_OVERRIDE;
     void mouseMoveEvent(QMouseEvent* event) Q_DECL_OVERRIDE;
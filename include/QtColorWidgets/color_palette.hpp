@@ -32,6 +32,8 @@
 
 namespace color_widgets {
 
+class PaletteFileData;
+
 class QCP_EXPORT ColorPalette : public QObject
 {
     Q_OBJECT
@@ -123,6 +125,13 @@ public:
      */
     Q_INVOKABLE bool load(const QString& name);
 
+    /**
+     * \brief Why the last call to load() failed
+     *
+     * Parse errors include the file name and the line number.
+     */
+    QString errorString() const;
+
     /**
      * \brief Creates a ColorPalette from a Gimp palette (gpl) file
      */
@@ -220,6 +229,7 @@ private:
      */
     void emitUpdate();
 
+    friend class PaletteFileData;
     class Private;
     Private *p;
 };
@@ -45,6 +45,35 @@ class QCP_EXPORT ColorPaletteModel : public QAbstractListModel
      */
     Q_PROPERTY(QSize iconSize READ iconSize WRITE setIconSize NOTIFY iconSizeChanged)
 
+    /**
+     * \brief Whether load() only reads the names and sizes of the palettes
+     *
+     * The colors of a palette are read the first time palette() or its
+     * preview is requested. Files with invalid colors are only found then,
+     * so they are listed with the palettes.
+     * Takes effect on the next call to load().
+     */
+    Q_PROPERTY(bool lazyLoading READ lazyLoading WRITE setLazyLoading NOTIFY lazyLoadingChanged)
+
+    /**
+     * \brief Maximum number of palettes keeping their colors with lazyLoading
+     *
+     * The colors of the least recently used palettes are dropped and read
+     * again from the file when needed. Palettes that have been added or
+     * updated are always kept. 0 means no limit.
+     */
+    Q_PROPERTY(int maxLoadedPalettes READ maxLoadedPalettes WRITE setMaxLoadedPalettes NOTIFY maxLoadedPalettesChanged)
+
+    /**
+     * \brief Whether load() keeps an index of the palette files in savePath
+     *
+     * The index stores the palettes with the size and modification time of
+     * their files, unchanged files are restored from it instead of being
+     * parsed again. The loaded palettes are the same as without the index.
+     * Disabled by default.
+     */
+    Q_PROPERTY(bool indexCache READ indexCache WRITE setIndexCache NOTIFY indexCacheChanged)
+
 
 public:
     ColorPaletteModel();
@@ -56,6 +85,9 @@ public:
     QString savePath() const;
     QStringList searchPaths() const;
     QSize iconSize() const;
+    bool lazyLoading() const;
+    int maxLoadedPalettes() const;
+    bool indexCache() const;
 
     /**
      * \brief Number of palettes
@@ -76,6 +108,9 @@ public:
     /**
      * \brief Get the palette at the given index (row)
      * \pre 0 <= index < count()
+     *
+     * With maxLoadedPalettes, the colors of the returned palette may be dropped
+     * by later calls so it should be copied rather than kept by reference.
      */
     const ColorPalette& palette(int index) const;
 
@@ -114,21 +149,59 @@ public:
      */
     int indexFromFile(const QString& filename) const;
 
+    /**
+     * \brief Whether loadAsync() is still loading files
+     */
+    bool isLoading() const;
+
 public Q_SLOTS:
     void setSavePath(const QString& savePath);
     void setSearchPaths(const QStringList& searchPaths);
     void addSearchPath(const QString& path);
     void setIconSize(const QSize& iconSize);
+    void setLazyLoading(bool lazyLoading);
+    void setMaxLoadedPalettes(int maxLoadedPalettes);
+    void setIndexCache(bool indexCache);
 
     /**
      * \brief Load palettes files found in the search paths
+     *
+     * Files are loaded in parallel, the palettes are in the same order
+     * as the search paths and sorted by file name within each of them.
      */
     void load();
 
+    /**
+     * \brief Same as load() but it returns immediately
+     *
+     * loadProgress() is emitted as files are loaded, then the model is reset
+     * once with all the palettes and loadFinished() is emitted.
+     * Calling load() or loadAsync() again discards the results of a running load.
+     */
+    void loadAsync();
+
 Q_SIGNALS:
     void savePathChanged(const QString& savePath);
     void searchPathsChanged(const QStringList& searchPaths);
     void iconSizeChanged(const QSize& iconSize);
+    void lazyLoadingChanged(bool lazyLoading);
+    void maxLoadedPalettesChanged(int maxLoadedPalettes);
+    void indexCacheChanged(bool indexCache);
+
+    /**
+     * \brief Emitted by loadAsync() after each file
+     * \param loaded   Number of files loaded so far
+     * \param total    Number of palette files in the search paths
+     */
+    void loadProgress(int loaded, int total);
+
+    /**
+     * \brief Emitted when loadAsync() has reset the model with the new palettes
+     */
+    void loadFinished();
+
+protected:
+    bool event(QEvent* event) Q_DECL_OVERRIDE;
 
 private:
     class Private;
@@ -0,0 +1,260 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_COLOR_SPACE_PRIVATE_HPP
+#define COLOR_WIDGETS_COLOR_SPACE_PRIVATE_HPP
+
+#include "QtColorWidgets/color_utils.hpp"
+#include "QtColorWidgets/oklab_private.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace color_widgets {
+namespace utils {
+
+/// sRGB transfer function, from linear light to the encoded value
+template<class T>
+inline T srgb_encode(T linear)
+{
+    if ( linear <= T(0.0031308) )
+        return linear * T(12.92);
+    return T(1.055) * std::pow(linear, T(1 / 2.4)) - T(0.055);
+}
+
+/// Inverse of srgb_encode()
+template<class T>
+inline T srgb_decode(T encoded)
+{
+    if ( encoded <= T(0.04045) )
+        return encoded / T(12.92);
+    return std::pow((encoded + T(0.055)) / T(1.055), T(2.4));
+}
+
+/*
+ * Fixed point HSV and HSL, shared by the integer conversions.
+ *
+ * Saturation, value and lightness are in [0, 65535], the hue in [0, 65536)
+ * is a fraction of a turn. RGB channels go up to Max, either 255 or 65535.
+ * Every result is the exact rational value rounded half up.
+ */
+
+/// hue_falloff() of a channel in fixed point, 65536 standing for 1
+inline qint64 fixed_hue_falloff(quint16 hue, int offset)
+{
+    const qint64 sextant = 65536;
+    qint64 k = qint64(hue) * 6 + offset * sextant;
+    if ( k >= 6 * sextant )
+        k -= 6 * sextant;
+    return qBound<qint64>(0, qMin(k, 4 * sextant - k), sextant);
+}
+
+/// Rounds a channel expressed as \p numerator / (65535^2 * 65536)
+template<quint32 Max>
+inline quint32 fixed_channel(qint64 numerator)
+{
+    const quint64 denominator = quint64(65535 / Max) * 65535 * 65536;
+    return quint32((quint64(numerator) + denominator / 2) / denominator);
+}
+
+/// Rounds \p numerator / \p denominator
+inline quint32 fixed_divide(quint64 numerator, quint64 denominator)
+{
+    return quint32((2 * numerator + denominator) / (2 * denominator));
+}
+
+template<quint32 Max>
+inline void fixed_hsv_to_rgb(quint16 hue, quint16 sat, quint16 val, quint32& r, quint32& g, quint32& b)
+{
+    const qint64 one = qint64(65535) * 65536;
+    r = fixed_channel<Max>(val * (one - sat * fixed_hue_falloff(hue, 5)));
+    g = fixed_channel<Max>(val * (one - sat * fixed_hue_falloff(hue, 3)));
+    b = fixed_channel<Max>(val * (one - sat * fixed_hue_falloff(hue, 1)));
+}
+
+template<quint32 Max>
+inline void fixed_hsl_to_rgb(quint16 hue, quint16 sat, quint16 lig, quint32& r, quint32& g, quint32& b)
+{
+    qint64 chroma = (65535 - qAbs(2 * qint64(lig) - 65535)) * sat;
+    qint64 middle = qint64(lig) * 65535 * 65536;
+    r = fixed_channel<Max>(middle + chroma * (32768 - fixed_hue_falloff(hue, 5)));
+    g = fixed_channel<Max>(middle + chroma * (32768 - fixed_hue_falloff(hue, 3)));
+    b = fixed_channel<Max>(middle + chroma * (32768 - fixed_hue_falloff(hue, 1)));
+}
+
+/// Hue of an RGB color, 0 for grays
+inline quint16 fixed_hue(quint32 r, quint32 g, quint32 b, quint32 max, quint32 chroma)
+{
+    if ( chroma == 0 )
+        return 0;
+    qint64 sextants;
+    if ( max == r )
+        sextants = qint64(g) - b;
+    else if ( max == g )
+        sextants = 2 * qint64(chroma) + b - r;
+    else
+        sextants = 4 * qint64(chroma) + r - g;
+    if ( sextants < 0 )
+        sextants += 6 * qint64(chroma);
+    // A full turn rounds to 65536, which wraps to 0
+    return quint16(fixed_divide(quint64(sextants) * 65536, 6 * quint64(chroma)));
+}
+
+template<quint32 Max>
+inline void fixed_rgb_to_hsv(quint32 r, quint32 g, quint32 b, quint16& hue, quint16& sat, quint16& val)
+{
+    quint32 max = qMax(r, qMax(g, b));
+    quint32 chroma = max - qMin(r, qMin(g, b));
+    hue = fixed_hue(r, g, b, max, chroma);
+    sat = max == 0 ? 0 : quint16(fixed_divide(quint64(chroma) * 65535, max));
+    val = quint16(max * (65535 / Max));
+}
+
+template<quint32 Max>
+inline void fixed_rgb_to_hsl(quint32 r, quint32 g, quint32 b, quint16& hue, quint16& sat, quint16& lig)
+{
+    quint32 max = qMax(r, qMax(g, b));
+    quint32 min = qMin(r, qMin(g, b));
+    quint32 chroma = max - min;
+    hue = fixed_hue(r, g, b, max, chroma);
+    quint32 spread = Max - quint32(qAbs(qint64(max) + min - Max));
+    sat = spread == 0 ? 0 : quint16(fixed_divide(quint64(chroma) * 65535, spread));
+    lig = quint16(fixed_divide(quint64(max + min) * 65535, 2 * Max));
+}
+
+} // namespace utils
+
+/*
+ * Color space policies, the renderers are instantiated for each of them.
+ *
+ * Components are hue, saturation-like and value-like in [0-1];
+ * line() clamps out of gamut colors while masked_line() makes them transparent.
+ */
+struct HsvSpace
+{
+    /// Gradient stops QGradient needs to draw the rainbow, it's linear between sextants
+    static const int hue_stops = 6;
+    static QColor color(qreal h, qreal s, qreal v, qreal a) { return QColor::fromHsvF(h, s, v, a); }
+    static QColor rainbow(qreal h) { return utils::rainbow_hsv(h); }
+    static void components(const QColor& c, qreal& h, qreal& s, qreal& v)
+    {
+        h = c.hsvHueF();
+        s = c.hsvSaturationF();
+        v = c.valueF();
+    }
+    static void line(const float* h, const float* s, const float* v, QRgb* out, int count)
+    {
+        utils::rgb_line_from_hsv(h, s, v, out, count);
+    }
+    /// HSV covers RGB exactly, nothing to mask
+    static void masked_line(const float* h, const float* s, const float* v, QRgb* out, int count)
+    {
+        line(h, s, v, out, count);
+    }
+    /// Same as rainbow() for a line of hues
+    static void rainbow_line(const float* h, QRgb* out, int count)
+    {
+        std::vector<float> ones(count, 1);
+        utils::rgb_line_from_hsv(h, ones.data(), ones.data(), out, count);
+    }
+};
+
+struct HslSpace
+{
+    static const int hue_stops = 6;
+    static QColor color(qreal h, qreal s, qreal l, qreal a) { return utils::color_from_hsl(h, s, l, a); }
+    static QColor rainbow(qreal h) { return utils::rainbow_hsv(h); }
+    static void components(const QColor& c, qreal& h, qreal& s, qreal& l)
+    {
+        h = c.hueF();
+        s = utils::color_HSL_saturationF(c);
+        l = utils::color_lightnessF(c);
+    }
+    static void line(const float* h, const float* s, const float* l, QRgb* out, int count)
+    {
+        utils::rgb_line_from_hsl(h, s, l, out, count);
+    }
+    /// HSL covers RGB exactly, nothing to mask
+    static void masked_line(const float* h, const float* s, const float* l, QRgb* out, int count)
+    {
+        line(h, s, l, out, count);
+    }
+    static void rainbow_line(const float* h, QRgb* out, int count)
+    {
+        HsvSpace::rainbow_line(h, out, count);
+    }
+};
+
+struct LchSpace
+{
+    static const int hue_stops = 6;
+    static QColor color(qreal h, qreal c, qreal l, qreal a) { return utils::color_from_lch(h, c, l, a); }
+    static QColor rainbow(qreal h) { return utils::rainbow_lch(h); }
+    static void components(const QColor& col, qreal& h, qreal& c, qreal& l)
+    {
+        h = col.hueF();
+        c = utils::color_chromaF(col);
+        l = utils::color_lumaF(col);
+    }
+    static void line(const float* h, const float* c, const float* l, QRgb* out, int count)
+    {
+        utils::rgb_line_from_lch(h, c, l, out, count);
+    }
+    static void masked_line(const float* h, const float* c, const float* l, QRgb* out, int count)
+    {
+        utils::rgb_line_from_lch(h, c, l, out, count, true);
+    }
+    static void rainbow_line(const float* h, QRgb* out, int count)
+    {
+        std::vector<float> ones(count, 1);
+        utils::rgb_line_from_lch(h, ones.data(), ones.data(), out, count);
+    }
+};
+
+struct OklchSpace
+{
+    /// The rainbow is curved in RGB, this keeps the gradient within a couple of units
+    static const int hue_stops = 36;
+    static QColor color(qreal h, qreal c, qreal l, qreal a) { return utils::color_from_oklch(h, c, l, a); }
+    static QColor rainbow(qreal h) { return utils::rainbow_oklch(h); }
+    static void components(const QColor& col, qreal& h, qreal& c, qreal& l)
+    {
+        utils::color_to_oklch(col, h, c, l);
+    }
+    static void line(const float* h, const float* c, const float* l, QRgb* out, int count)
+    {
+        utils::rgb_line_from_oklch(h, c, l, out, count);
+    }
+    static void masked_line(const float* h, const float* c, const float* l, QRgb* out, int count)
+    {
+        utils::rgb_line_from_oklch(h, c, l, out, count, true);
+    }
+    static void rainbow_line(const float* h, QRgb* out, int count)
+    {
+        std::vector<float> chroma(count, float(utils::rainbow_oklch_chroma));
+        std::vector<float> lightness(count, float(utils::rainbow_oklch_lightness));
+        utils::rgb_line_from_oklch(h, chroma.data(), lightness.data(), out, count);
+    }
+};
+
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_COLOR_SPACE_PRIVATE_HPP
@@ -27,33 +27,52 @@
 #include <qmath.h>
 
 #include "QtColorWidgets/colorwidgets_global.hpp"
+#include "QtColorWidgets/rgba.hpp"
+
+class QWidget;
 
 namespace color_widgets {
 namespace utils {
 
 
-QCP_EXPORT inline qreal color_chromaF(const QColor& c)
+/*
+ * Overloads for Rgba32f, they read the channels directly instead of
+ * converting them through QColor on every call. They work in single
+ * precision, so the QColor overloads below don't forward to them.
+ */
+QCP_EXPORT constexpr float color_chromaF(const Rgba32f& c)
 {
-    qreal max = qMax(c.redF(), qMax(c.greenF(), c.blueF()));
-    qreal min = qMin(c.redF(), qMin(c.greenF(), c.blueF()));
-    return max - min;
+    return qMax(c.r, qMax(c.g, c.b)) - qMin(c.r, qMin(c.g, c.b));
 }
 
-QCP_EXPORT inline qreal color_lumaF(const QColor& c)
+QCP_EXPORT constexpr float color_lumaF(const Rgba32f& c)
 {
-    return 0.30 * c.redF() + 0.59 * c.greenF() + 0.11 * c.blueF();
+    return 0.30f * c.r + 0.59f * c.g + 0.11f * c.b;
 }
 
-QCP_EXPORT QColor color_from_lch(qreal hue, qreal chroma, qreal luma, qreal alpha = 1 );
+QCP_EXPORT constexpr float color_lightnessF(const Rgba32f& c)
+{
+    return ( qMax(c.r, qMax(c.g, c.b)) + qMin(c.r, qMin(c.g, c.b)) ) / 2;
+}
 
-QCP_EXPORT inline QColor rainbow_lch(qreal hue)
+QCP_EXPORT inline float color_HSL_saturationF(const Rgba32f& col)
 {
-    return color_from_lch(hue,1,1);
+    float spread = 1 - qAbs(2 * color_lightnessF(col) - 1);
+    if ( spread < 1e-6f )
+        return 0;
+    return qMin(color_chromaF(col) / spread, 1.f);
 }
 
-QCP_EXPORT inline QColor rainbow_hsv(qreal hue)
+QCP_EXPORT inline qreal color_chromaF(const QColor& c)
 {
-    return QColor::fromHsvF(hue,1,1);
+    qreal max = qMax(c.redF(), qMax(c.greenF(), c.blueF()));
+    qreal min = qMin(c.redF(), qMin(c.greenF(), c.blueF()));
+    return max - min;
+}
+
+QCP_EXPORT inline qreal color_lumaF(const QColor& c)
+{
+    return 0.30 * c.redF() + 0.59 * c.greenF() + 0.11 * c.blueF();
 }
 
 QCP_EXPORT inline qreal color_lightnessF(const QColor& c)
@@ -71,11 +90,219 @@ QCP_EXPORT inline qreal color_HSL_saturationF(const QColor& col)
     return c / (1-qAbs(2*l-1));
 }
 
+QCP_EXPORT QColor color_from_lch(qreal hue, qreal chroma, qreal luma, qreal alpha = 1 );
+
+QCP_EXPORT inline QColor rainbow_lch(qreal hue)
+{
+    return color_from_lch(hue,1,1);
+}
+
+QCP_EXPORT inline QColor rainbow_hsv(qreal hue)
+{
+    return QColor::fromHsvF(hue,1,1);
+}
+
 
 QCP_EXPORT QColor color_from_hsl(qreal hue, qreal sat, qreal lig, qreal alpha = 1 );
 
+/// OKLCH chroma corresponding to a chroma component of 1, as for CSS percentages
+const qreal oklch_max_chroma = 0.4;
+
+/**
+ * \brief Converts OKLCH to a color, clamping it to the sRGB gamut
+ * \param hue       Hue angle in [0-1]
+ * \param chroma    Chroma in [0-1], scaled by oklch_max_chroma
+ * \param lightness Perceptual lightness in [0-1]
+ */
+QCP_EXPORT QColor color_from_oklch(qreal hue, qreal chroma, qreal lightness, qreal alpha = 1 );
+
+/**
+ * \brief Converts a color to OKLCH, with the same ranges as color_from_oklch()
+ *
+ * \p hue is set to -1 for achromatic colors
+ */
+QCP_EXPORT void color_to_oklch(const QColor& c, qreal& hue, qreal& chroma, qreal& lightness);
+
+/**
+ * \brief Converts OKLab to a color, clamping it to the sRGB gamut
+ * \param lightness Perceptual lightness in [0-1]
+ * \param a         Green to red axis, roughly in [-0.4, 0.4]
+ * \param b         Blue to yellow axis, roughly in [-0.4, 0.4]
+ */
+QCP_EXPORT QColor color_from_oklab(qreal lightness, qreal a, qreal b, qreal alpha = 1 );
+
+/// Converts a color to OKLab, with the same ranges as color_from_oklab()
+QCP_EXPORT void color_to_oklab(const QColor& c, qreal& lightness, qreal& a, qreal& b);
+
+/// Same as color_from_oklch(), without going through QColor
+QCP_EXPORT Rgba32f rgba_from_oklch(float hue, float chroma, float lightness, float alpha = 1);
+
+/// Same as color_to_oklch(), without going through QColor
+QCP_EXPORT void color_to_oklch(const Rgba32f& c, float& hue, float& chroma, float& lightness);
+
+/// Same as color_from_oklab(), without going through QColor
+QCP_EXPORT Rgba32f rgba_from_oklab(float lightness, float a, float b, float alpha = 1);
+
+/// Same as color_to_oklab(), without going through QColor
+QCP_EXPORT void color_to_oklab(const Rgba32f& c, float& lightness, float& a, float& b);
+
+/// OKLCH components of rainbow_oklch(), the highest chroma in gamut for every hue
+const qreal rainbow_oklch_chroma = 0.125 / oklch_max_chroma;
+const qreal rainbow_oklch_lightness = 0.75;
+
+QCP_EXPORT inline QColor rainbow_oklch(qreal hue)
+{
+    return color_from_oklch(hue, rainbow_oklch_chroma, rainbow_oklch_lightness);
+}
+
+/**
+ * \brief Converts integer HSV to an opaque packed color
+ *
+ * Saturation and value are in [0, 65535], the hue is a fraction of a turn
+ * in [0, 65536) so it wraps around like quint16 does.
+ * It only uses integer math and each channel is rounded exactly.
+ */
+QCP_EXPORT QRgb rgb_from_hsv16(quint16 hue, quint16 sat, quint16 val);
+
+/**
+ * \brief Converts a packed color to integer HSV, ignoring alpha
+ *
+ * rgb_from_hsv16() gives back the same color. Grays have a hue of 0.
+ */
+QCP_EXPORT void rgb_to_hsv16(QRgb rgb, quint16& hue, quint16& sat, quint16& val);
+
+/**
+ * \brief Converts integer HSL to an opaque packed color
+ * \see rgb_from_hsv16()
+ */
+QCP_EXPORT QRgb rgb_from_hsl16(quint16 hue, quint16 sat, quint16 lig);
+
+/**
+ * \brief Converts a packed color to integer HSL, ignoring alpha
+ * \see rgb_to_hsv16()
+ */
+QCP_EXPORT void rgb_to_hsl16(QRgb rgb, quint16& hue, quint16& sat, quint16& lig);
+
+/**
+ * \brief Converts a line of HSV colors to opaque packed RGB
+ *
+ * All the input components are in [0-1], each array holds \p count values.
+ * Uses the SIMD kernels reported by batch_instruction_set().
+ */
+QCP_EXPORT void rgb_line_from_hsv(const float* hue, const float* sat, const float* val, QRgb* out, int count);
+
+/**
+ * \brief Converts a line of HSL colors to opaque packed RGB
+ * \see rgb_line_from_hsv
+ */
+QCP_EXPORT void rgb_line_from_hsl(const float* hue, const float* sat, const float* lig, QRgb* out, int count);
+
+/**
+ * \brief Converts a line of LCH colors to opaque packed RGB
+ *
+ * Colors outside the RGB gamut are clamped, or set to transparent
+ * if \p mask_gamut is \b true.
+ * \see rgb_line_from_hsv, color_from_lch
+ */
+QCP_EXPORT void rgb_line_from_lch(const float* hue, const float* chroma, const float* luma, QRgb* out, int count,
+                                  bool mask_gamut = false);
+
+/**
+ * \brief Converts a line of OKLCH colors to opaque packed RGB
+ *
+ * Colors outside the sRGB gamut are clamped, or set to transparent
+ * if \p mask_gamut is \b true.
+ * \see rgb_line_from_hsv, color_from_oklch
+ */
+QCP_EXPORT void rgb_line_from_oklch(const float* hue, const float* chroma, const float* lightness, QRgb* out, int count,
+                                    bool mask_gamut = false);
+
+/**
+ * \brief Converts a line of colors sharing the same hue to opaque packed RGB
+ *
+ * Each channel is computed as <tt>top - chroma * k</tt> where \c k only
+ * depends on the hue, so this is cheaper than the other line conversions.
+ * For HSV, \p top is the value and \p chroma is value * saturation.
+ */
+QCP_EXPORT void rgb_line_from_hue(qreal hue, const float* top, const float* chroma, QRgb* out, int count);
+
+/// Color spaces of the batch conversions, components are listed in array order
+enum class BatchColorSpace
+{
+    HSV,    ///< Hue, saturation and value in [0-1]
+    HSL,    ///< Hue, saturation and lightness in [0-1]
+    LCH,    ///< Hue, chroma and luma in [0-1] as for color_from_lch()
+    CIELab, ///< CIE L*a*b* for a D65 white point, L in [0-100], a and b roughly in [-128, 128]
+    OKLab,  ///< OKLab, L in [0-1], a and b roughly in [-0.4, 0.4]
+};
+
+/**
+ * \brief Converts sRGB colors to \p space
+ *
+ * \p rgb and \p out hold \p count interleaved triplets, they may be the same array.
+ * RGB channels are in [0-1].
+ *
+ * The results match the scalar conversions (QColor for HSV, color_lightnessF(),
+ * color_lumaF() and so on) within 1e-4, and double precision CIELab and OKLab
+ * within 1e-3 of their ranges. The hue of a gray is 0, not -1.
+ */
+QCP_EXPORT void convert_from_rgb(BatchColorSpace space, const float* rgb, float* out, int count);
+
+/**
+ * \brief Converts colors in \p space to sRGB
+ *
+ * The layout and tolerance are the same as for convert_from_rgb().
+ * Channels aren't clamped so colors outside the sRGB gamut fall outside [0-1].
+ */
+QCP_EXPORT void convert_to_rgb(BatchColorSpace space, const float* in, float* rgb, int count);
+
+/**
+ * \brief Converts packed colors to \p space, ignoring alpha
+ * \see convert_from_rgb(BatchColorSpace, const float*, float*, int)
+ */
+QCP_EXPORT void convert_from_rgb(BatchColorSpace space, const QRgb* rgb, float* out, int count);
+
+/**
+ * \brief Converts colors in \p space to opaque packed RGB, clamping out of gamut colors
+ *
+ * Channels are within one unit of rounding the float conversion.
+ * \see convert_to_rgb(BatchColorSpace, const float*, float*, int)
+ */
+QCP_EXPORT void convert_to_rgb(BatchColorSpace space, const float* in, QRgb* rgb, int count);
+
+/**
+ * \brief Converts packed colors to integer HSV or HSL
+ *
+ * \p out holds \p count triplets with the ranges of rgb_to_hsv16(),
+ * only BatchColorSpace::HSV and BatchColorSpace::HSL are supported.
+ * \returns \b false without touching \p out if \p space isn't supported
+ */
+QCP_EXPORT bool convert_from_rgb(BatchColorSpace space, const QRgb* rgb, quint16* out, int count);
+
+/**
+ * \brief Converts integer HSV or HSL to opaque packed colors
+ * \returns \b false without touching \p rgb if \p space isn't supported
+ * \see convert_from_rgb(BatchColorSpace, const QRgb*, quint16*, int)
+ */
+QCP_EXPORT bool convert_to_rgb(BatchColorSpace space, const quint16* in, QRgb* rgb, int count);
+
+/**
+ * \brief Name of the SIMD kernels used by the batch conversions
+ *
+ * The widest instruction set supported by the CPU is picked at runtime:
+ * "avx2", "sse2", "neon" or "scalar".
+ */
+QCP_EXPORT const char* batch_instruction_set();
+
 QCP_EXPORT QColor get_screen_color(const QPoint &global_pos);
 
+/**
+ * \brief Milliseconds between two frames on the screen showing \p widget
+ *
+ * Used to throttle work triggered by input events to the refresh rate.
+ */
+QCP_EXPORT int frame_interval(const QWidget* widget);
+
 } // namespace utils
 } // namespace color_widgets
 
@@ -47,6 +47,66 @@ class QCP_EXPORT ColorWheel : public QWidget
     Q_PROPERTY(ShapeEnum selectorShape READ selectorShape WRITE setSelectorShape NOTIFY selectorShapeChanged DESIGNABLE true )
     Q_PROPERTY(bool rotatingSelector READ rotatingSelector WRITE setRotatingSelector NOTIFY rotatingSelectorChanged DESIGNABLE true )
     Q_PROPERTY(ColorSpaceEnum colorSpace READ colorSpace WRITE setColorSpace NOTIFY colorSpaceChanged DESIGNABLE true )
+    /**
+     * \brief Number of threads used to render the inner selector
+     *
+     * 1 renders on the calling thread only, 0 uses QThread::idealThreadCount()
+     */
+    Q_PROPERTY(int renderThreads READ renderThreads WRITE setRenderThreads NOTIFY renderThreadsChanged)
+    /**
+     * \brief Memory budget in bytes for the cache of rendered inner selectors
+     *
+     * 0 disables the cache.
+     */
+    Q_PROPERTY(int selectorCacheSize READ selectorCacheSize WRITE setSelectorCacheSize NOTIFY selectorCacheSizeChanged)
+    /**
+     * \brief Number of hues the cached inner selectors are rendered at
+     *
+     * With 360 (the default), the selector is rendered at the hue rounded to
+     * one degree so dragging back and forth reuses the cached images, the
+     * difference isn't visible.
+     * 0 renders the exact hue, so the cache only helps with repeated hues.
+     */
+    Q_PROPERTY(int selectorCacheHueSteps READ selectorCacheHueSteps WRITE setSelectorCacheHueSteps NOTIFY selectorCacheHueStepsChanged)
+    /**
+     * \brief Factor the inner selector resolution is divided by while dragging the hue
+     *
+     * The full resolution selector is rendered when the mouse is released
+     * or stops moving for a short while, 1 disables the reduced previews.
+     */
+    Q_PROPERTY(int progressiveDownscale READ progressiveDownscale WRITE setProgressiveDownscale NOTIFY progressiveDownscaleChanged)
+    /**
+     * \brief Maximum number of pixels rendered for the inner selector
+     *
+     * The selector is rendered at its physical size on screen (taking the
+     * device pixel ratio into account) and scaled down to fit this budget,
+     * 0 removes the limit. The budget counts physical pixels, the default of
+     * 128x128 keeps the cost of earlier versions. Raise it for a sharper
+     * selector on high DPI screens.
+     */
+    Q_PROPERTY(int selectorPixelBudget READ selectorPixelBudget WRITE setSelectorPixelBudget NOTIFY selectorPixelBudgetChanged)
+    /**
+     * \brief Whether mouse drags are processed at most once per screen refresh
+     *
+     * When enabled, only the latest of the mouse move events received within
+     * a frame is processed, which also limits the rate of colorChanged().
+     * Disable it to process every event.
+     */
+    Q_PROPERTY(bool coalesceInput READ coalesceInput WRITE setCoalesceInput NOTIFY coalesceInputChanged)
+    /**
+     * \brief Whether the inner selector is rendered on a background thread
+     *
+     * When enabled the widget keeps showing the last rendered selector until
+     * the new one is ready, requests superseded by a newer one are dropped.
+     */
+    Q_PROPERTY(bool asyncRender READ asyncRender WRITE setAsyncRender NOTIFY asyncRenderChanged)
+    /**
+     * \brief Milliseconds the size has to be stable before re-rendering
+     *
+     * While the widget is being resized, the images rendered for the
+     * previous size are scaled. 0 re-renders on every resize.
+     */
+    Q_PROPERTY(int resizeDebounce READ resizeDebounce WRITE setResizeDebounce NOTIFY resizeDebounceChanged)
 
 public:
     enum ShapeEnum
@@ -66,6 +126,7 @@ public:
         ColorHSV,       ///< Use the HSV color space
         ColorHSL,       ///< Use the HSL color space
         ColorLCH,       ///< Use Luma Chroma Hue (Y_601')
+        ColorOKLCH,     ///< Use the polar form of OKLab, perceptually uniform
     };
 
     Q_ENUM(ShapeEnum);
@@ -104,6 +165,36 @@ public:
     /// Color space used to preview/edit the color
     ColorSpaceEnum colorSpace() const;
 
+    /// Number of threads used to render the inner selector
+    int renderThreads() const;
+
+    /// Memory budget in bytes for the cache of rendered inner selectors
+    int selectorCacheSize() const;
+
+    /// Number of hues the cached inner selectors are rendered at, 0 for the exact hue
+    int selectorCacheHueSteps() const;
+
+    /// Number of times the inner selector has been taken from the cache
+    qint64 selectorCacheHits() const;
+
+    /// Number of times the inner selector has been rendered with the cache enabled
+    qint64 selectorCacheMisses() const;
+
+    /// Factor the inner selector resolution is divided by while dragging the hue
+    int progressiveDownscale() const;
+
+    /// Maximum number of pixels rendered for the inner selector
+    int selectorPixelBudget() const;
+
+    /// Whether mouse drags are processed at most once per screen refresh
+    bool coalesceInput() const;
+
+    /// Whether the inner selector is rendered on a background thread
+    bool asyncRender() const;
+
+    /// Milliseconds the size has to be stable before re-rendering
+    int resizeDebounce() const;
+
 public Q_SLOTS:
 
     /// Set current color
@@ -133,6 +224,30 @@ public Q_SLOTS:
     /// Sets the color space used to preview/edit the color
     void setColorSpace(ColorSpaceEnum space);
 
+    /// Sets the number of threads used to render the inner selector
+    void setRenderThreads(int threads);
+
+    /// Sets the memory budget in bytes for the cache of rendered inner selectors
+    void setSelectorCacheSize(int bytes);
+
+    /// Sets the number of hues the cached inner selectors are rendered at, 0 for the exact hue
+    void setSelectorCacheHueSteps(int steps);
+
+    /// Sets the factor the inner selector resolution is divided by while dragging the hue
+    void setProgressiveDownscale(int factor);
+
+    /// Sets the maximum number of pixels rendered for the inner selector
+    void setSelectorPixelBudget(int pixels);
+
+    /// Sets whether mouse drags are processed at most once per screen refresh
+    void setCoalesceInput(bool coalesce);
+
+    /// Sets whether the inner selector is rendered on a background thread
+    void setAsyncRender(bool async);
+
+    /// Sets the milliseconds the size has to be stable before re-rendering
+    void setResizeDebounce(int msecs);
+
 Q_SIGNALS:
     /**
      * Emitted when the user selects a color or setColor is called
@@ -152,12 +267,29 @@ Q_SIGNALS:
 
     void colorSpaceChanged(ColorSpaceEnum space);
 
+    void renderThreadsChanged(int threads);
+
+    void selectorCacheSizeChanged(int bytes);
+
+    void selectorCacheHueStepsChanged(int steps);
+
+    void progressiveDownscaleChanged(int factor);
+
+    void selectorPixelBudgetChanged(int pixels);
+
+    void coalesceInputChanged(bool coalesce);
+
+    void asyncRenderChanged(bool async);
+
+    void resizeDebounceChanged(int msecs);
+
     /**
      * Emitted when the user releases from dragging
      */
     void editingFinished();
 
 protected:
+    bool event(QEvent* event) Q_DECL_OVERRIDE;
     void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
     void mouseMoveEvent(QMouseEvent *) Q_DECL_OVERRIDE;
     void mousePressEvent(QMouseEvent *) Q_DECL_OVERRIDE;
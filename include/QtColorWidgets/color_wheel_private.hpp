@@ -23,10 +23,21 @@
 
 #include "QtColorWidgets/color_wheel.hpp"
 #include "QtColorWidgets/color_utils.hpp"
+#include "QtColorWidgets/color_space_private.hpp"
 
 #include <QPainter>
 #include <QPainterPath>
 #include <QMouseEvent>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QCache>
+#include <QTimer>
+#include <QPixmapCache>
+#include <QCoreApplication>
+#include <QAtomicInt>
+
+#include <functional>
 
 namespace color_widgets {
 
@@ -37,12 +48,205 @@ enum MouseStatus
     DragSquare
 };
 
+/**
+ * \brief Renders a range of rows of the selector image from a thread pool
+ */
+class RenderBand : public QRunnable
+{
+public:
+    RenderBand(const std::function<void (int, int)>& render_rows, int begin, int end)
+        : render_rows(render_rows), begin(begin), end(end)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        render_rows(begin, end);
+    }
+
+private:
+    std::function<void (int, int)> render_rows;
+    int begin;
+    int end;
+};
+
+/**
+ * \brief Runs a function from a thread pool
+ */
+class RenderTask : public QRunnable
+{
+public:
+    explicit RenderTask(const std::function<void ()>& render)
+        : render(render)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        render();
+    }
+
+private:
+    std::function<void ()> render;
+};
+
+/**
+ * \brief Identifies a rendered selector image in ColorWheel::Private::selector_cache
+ */
+struct SelectorCacheKey
+{
+    qreal hue; ///< Hue the image is rendered at, see ColorWheel::Private::selector_cache_hue_steps
+    ColorWheel::ColorSpaceEnum color_space;
+    ColorWheel::ShapeEnum shape;
+    QSizeF size; ///< Exact image size, as the triangle coordinates depend on it
+
+    bool operator==(const SelectorCacheKey& other) const
+    {
+        return hue == other.hue && color_space == other.color_space &&
+               shape == other.shape && size == other.size;
+    }
+};
+
+inline uint qHash(const SelectorCacheKey& key, uint seed = 0)
+{
+    uint hash = ::qHash(key.hue, seed) ^ (uint(key.color_space) << 4 | uint(key.shape));
+    hash = hash * 31 + ::qHash(key.size.width(), seed);
+    return hash * 31 + ::qHash(key.size.height(), seed);
+}
+
+/**
+ * \brief Posted to the widget when an asynchronous selector render is done
+ */
+class SelectorRenderedEvent : public QEvent
+{
+public:
+    SelectorRenderedEvent(int generation, const SelectorCacheKey& key, bool cache, const QImage& image)
+        : QEvent(event_type()), generation(generation), key(key), cache(cache), image(image)
+    {}
+
+    static QEvent::Type event_type()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+    int generation; ///< Value of ColorWheel::Private::render_generation for the request
+    SelectorCacheKey key;
+    bool cache;     ///< Whether the image should be added to the selector cache
+    QImage image;
+};
+
+/**
+ * \brief Saturation/value coordinates of the pixels of a triangle selector image
+ *
+ * It only depends on the image size. In each row the pixels inside the
+ * triangle are a single span ending at the right edge, the pixels before
+ * it are clipped away when painting so they are never rendered.
+ */
+struct TriangleCoordMap
+{
+    /// Image size the map has been built for
+    QSizeF size;
+    /// Value of each column
+    std::vector<float> val;
+    /// Saturation of each pixel, in fixed point with 65535 as 1
+    std::vector<quint16> sat;
+    /// Index of the first pixel of each row that needs to be rendered
+    std::vector<int> row_begin;
+};
+
+/*
+ * Selector shape tags, used to pick the coordinate functions at compile time
+ */
+struct SquareShape {};
+struct TriangleShape {};
+
+/**
+ * \brief Renders the hue ring pixel by pixel
+ *
+ * Each pixel gets the exact hue at its center and its alpha is the
+ * analytic coverage of the ring edges.
+ *
+ * \param outer_radius Outer radius in logical pixels
+ * \param inner_radius Inner radius in logical pixels
+ * \param dpr          Device pixel ratio of the returned image
+ */
+template<class Space>
+QImage render_ring_image(int outer_radius, int inner_radius, qreal dpr)
+{
+    int size = qCeil(outer_radius * 2 * dpr);
+    QImage ring(qMax(size, 0), qMax(size, 0), QImage::Format_ARGB32_Premultiplied);
+    ring.setDevicePixelRatio(dpr);
+
+    qreal center = size / 2.0;
+    qreal outer = outer_radius * dpr;
+    qreal inner = inner_radius * dpr;
+    std::vector<float> hues(qMax(size, 0));
+    std::vector<QRgb> colors(qMax(size, 0));
+
+    for ( int y = 0; y < size; y++ )
+    {
+        // Flipped so the hue goes counter-clockwise like QLineF::angle()
+        qreal dy = center - (y + 0.5);
+        for ( int x = 0; x < size; x++ )
+        {
+            float hue = std::atan2(dy, x + 0.5 - center) / (2 * M_PI);
+            hues[x] = hue < 0 ? hue + 1 : hue;
+        }
+        Space::rainbow_line(hues.data(), colors.data(), size);
+
+        QRgb* line = reinterpret_cast<QRgb*>(ring.scanLine(y));
+        for ( int x = 0; x < size; x++ )
+        {
+            qreal distance = std::hypot(x + 0.5 - center, dy);
+            qreal coverage = qBound(0.0, outer - distance + 0.5, 1.0) *
+                             qBound(0.0, distance - inner + 0.5, 1.0);
+            int alpha = qRound(coverage * 255);
+            line[x] = qPremultiply(qRgba(qRed(colors[x]), qGreen(colors[x]), qBlue(colors[x]), alpha));
+        }
+    }
+
+    return ring;
+}
+
 class ColorWheel::Private
 {
 private:
     ColorWheel * const w;
 
 public:
+    /**
+     * \brief Parameters of a selector render
+     *
+     * Taken on the GUI thread so the render itself doesn't need the widget
+     */
+    struct SelectorJob
+    {
+        qreal hue;
+        QSizeF size;            ///< selector_image_size()
+        qreal logical_height;   ///< Height of selector_size()
+        ShapeEnum shape;
+        ColorSpaceEnum color_space;
+        void (Private::*render_rows)(qreal selector_hue, int width, int begin, int end, QRgb* out);
+        int threads;
+
+        QSize image_size() const
+        {
+            return size.toSize().expandedTo(QSize(0, 0));
+        }
+
+        /// Device pixel ratio of the rendered image
+        qreal pixel_ratio() const
+        {
+            int height = image_size().height();
+            return logical_height > 0 && height > 0 ? height / logical_height : 1;
+        }
+
+        bool operator==(const SelectorJob& o) const
+        {
+            return hue == o.hue && size == o.size && logical_height == o.logical_height &&
+                   shape == o.shape && color_space == o.color_space && threads == o.threads;
+        }
+    };
+
     qreal hue, sat, val;
     bool backgroundIsDark;
     unsigned int wheel_width;
@@ -55,13 +259,89 @@ public:
     ShapeEnum selector_shape = ShapeTriangle;
     QColor (*color_from)(qreal,qreal,qreal,qreal);
     QColor (*rainbow_from_hue)(qreal);
-    int max_size = 128;
+    QImage (*ring_image_from)(int outer_radius, int inner_radius, qreal dpr);
+    /// Renders rows of the selector into \p out, instantiated for color_space and selector_shape
+    void (Private::*render_selector_rows)(qreal selector_hue, int width, int begin, int end, QRgb* out);
+    /**
+     * \brief Maximum number of physical pixels rendered for the selector, 0 for no limit
+     *
+     * The default matches the 128 pixels per side the selector used to be limited to.
+     */
+    int selector_pixel_budget = 128 * 128;
+    /// Number of threads used by render_bands(), 0 for automatic
+    int render_threads = 1;
+    /// Minimum number of rows worth sending to a different thread
+    static const int min_band_rows = 32;
+    QThreadPool render_pool;
+    /// Rendered selector images, the cost is their size in bytes
+    QCache<SelectorCacheKey, QImage> selector_cache{4 * 1024 * 1024};
+    /// Hue resolution of the cached images, 0 renders and caches the exact hue
+    int selector_cache_hue_steps = 360;
+    qint64 selector_cache_hits = 0;
+    qint64 selector_cache_misses = 0;
+    /// Resolution divisor used while dragging the hue, 1 to disable previews
+    int progressive_downscale = 1;
+    /// Set while the release position goes through mouseMoveEvent(), see render_preview()
+    bool releasing = false;
+    /// Resolution divisor applied to the selector image being rendered
+    int preview_downscale = 1;
+    /// Renders the full resolution selector when a drag is idle
+    QTimer full_render_timer;
+    /// Per pixel value of the HSV selector, see update_hsv_planes()
+    std::vector<float> hsv_value_plane;
+    /// Per pixel value * saturation of the HSV selector
+    std::vector<float> hsv_chroma_plane;
+    ShapeEnum hsv_planes_shape = ShapeTriangle;
+    QSizeF hsv_planes_size;
+    TriangleCoordMap triangle_map;
+    /// Whether drag events are processed at most once per frame
+    bool coalesce_input = true;
+    /// Running while drag events are being coalesced
+    QTimer input_timer;
+    /// Latest drag event received while input_timer was running
+    bool input_pending = false;
+    QPointF pending_pos;
+    Qt::MouseButtons pending_buttons;
+    Qt::KeyboardModifiers pending_modifiers;
+    /// Whether the selector is rendered on async_pool instead of the GUI thread
+    bool async_render = false;
+    /// Single thread rendering the selector when async_render is enabled
+    QThreadPool async_pool;
+    /// Incremented for each asynchronous request, older ones are stale
+    QAtomicInt render_generation;
+    /// Whether the last asynchronous request hasn't been shown yet
+    bool async_pending = false;
+    /// Parameters of the last asynchronous request
+    SelectorJob async_job;
+    /// Images rendered by async_pool, alternating between the two
+    QImage async_images[2];
+    int async_back = 0;
+    /// Milliseconds the size has to be stable before re-rendering
+    int resize_debounce = 100;
+    /// Running while the widget is being resized
+    QTimer resize_timer;
 
     Private(ColorWheel *widget)
         : w(widget), hue(0), sat(0), val(0),
         wheel_width(20), mouse_status(Nothing),
-        color_from(&QColor::fromHsvF), rainbow_from_hue(&utils::rainbow_hsv)
+        color_from(&HsvSpace::color), rainbow_from_hue(&HsvSpace::rainbow),
+        ring_image_from(&render_ring_image<HsvSpace>),
+        render_selector_rows(&Private::render_rows<HsvSpace, TriangleShape>)
     {
+        full_render_timer.setSingleShot(true);
+        full_render_timer.setInterval(150);
+        QObject::connect(&full_render_timer, &QTimer::timeout, [this]{
+            finish_preview();
+        });
+        input_timer.setSingleShot(true);
+        QObject::connect(&input_timer, &QTimer::timeout, [this]{
+            flush_input();
+        });
+        async_pool.setMaxThreadCount(1);
+        resize_timer.setSingleShot(true);
+        QObject::connect(&resize_timer, &QTimer::timeout, [this]{
+            finish_resize();
+        });
     }
 
     void setup()
@@ -70,7 +350,10 @@ public:
         backgroundIsDark = backgroundValue < 0.5;
     }
 
-    virtual ~Private(){}
+    virtual ~Private()
+    {
+        wait_async_render();
+    }
 
     /// Calculate outer wheel radius from idget center
     qreal outer_radius() const
@@ -115,7 +398,8 @@ public:
     void init_buffer(QSize size)
     {
         std::size_t linear_size = size.width() * size.height();
-        if ( inner_selector_buffer.size() == linear_size )
+        if ( inner_selector_buffer.size() == linear_size &&
+             inner_selector.constBits() == reinterpret_cast<const uchar*>(inner_selector_buffer.data()) )
             return;
         inner_selector_buffer.resize(linear_size);
         inner_selector = QImage(
@@ -126,57 +410,564 @@ public:
         );
     }
 
-    void render_square()
+    /// Saturation and value of the pixels in row \p y of the square selector image
+    void square_row_coords(int width, int y, float* sats, float* vals) const
     {
-        int width = qMin<int>(square_size(), max_size);
-        init_buffer(QSize(width, width));
-
-        for ( int y = 0; y < width; ++y )
+        for ( int x = 0; x < width; ++x )
         {
-            for ( int x = 0; x < width; ++x )
-            {
-                QRgb color = color_from(hue,double(x)/width,double(y)/width,1).rgb();
-                inner_selector_buffer[width * y + x] = color;
-            }
+            sats[x] = float(x) / width;
+            vals[x] = float(y) / width;
         }
     }
 
     /**
-     * \brief renders the selector as a triangle
+     * \brief Ensures triangle_map matches the triangle selector image
      * \note It's the same as a square with the edge with value=0 collapsed to a single point
      */
-    void render_triangle()
+    void update_triangle_map(const QSizeF& size, const QSize& isize)
     {
-        QSizeF size = selector_size();
-        if ( size.height() > max_size )
-            size *= max_size / size.height();
+        if ( triangle_map.size == size )
+            return;
 
+        int width = isize.width();
+        int height = isize.height();
         qreal ycenter = size.height()/2;
 
-        QSize isize = size.toSize();
-        init_buffer(isize);
+        triangle_map.size = size;
+        triangle_map.val.resize(width);
+        triangle_map.sat.assign(std::size_t(width) * height, 0);
+        triangle_map.row_begin.resize(height);
+
+        for ( int x = 0; x < width; x++ )
+            triangle_map.val[x] = x / size.height();
 
-        for (int x = 0; x < isize.width(); x++ )
+        for ( int y = 0; y < height; y++ )
         {
-            qreal pval = x / size.height();
-            qreal slice_h = size.height() * pval;
-            for (int y = 0; y < isize.height(); y++ )
+            // The triangle covers x >= 2 * |y - ycenter|, the margin keeps
+            // the pixels that are partially visible through the antialiased clip
+            int begin = qBound(0, int(2 * qAbs(y - ycenter)) - 2, width);
+            triangle_map.row_begin[y] = begin;
+
+            quint16* sat = triangle_map.sat.data() + std::size_t(width) * y;
+            for ( int x = begin; x < width; x++ )
             {
+                qreal slice_h = x; // size.height() * val[x]
                 qreal ymin = ycenter-slice_h/2;
-                qreal psat = qBound(0.0,(y-ymin)/slice_h,1.0);
-                QRgb color = color_from(hue,psat,pval,1).rgb();
-                inner_selector_buffer[isize.width() * y + x] = color;
+                sat[x] = qRound(qBound(0.0,(y-ymin)/slice_h,1.0) * 65535);
             }
         }
     }
 
-    /// Updates the inner image that displays the saturation-value selector
-    void render_inner_selector()
+    /**
+     * \brief Saturation and value of the pixels in row \p y of the triangle selector image
+     * \pre update_triangle_map() has been called for the current image
+     * \returns Index of the first pixel that needs to be rendered
+     */
+    int triangle_row_coords(int width, int y, float* sats, float* vals) const
+    {
+        int begin = triangle_map.row_begin[y];
+        const quint16* sat = triangle_map.sat.data() + std::size_t(width) * y;
+        for ( int x = begin; x < width; x++ )
+        {
+            sats[x] = sat[x] * (1.f / 65535);
+            vals[x] = triangle_map.val[x];
+        }
+        return begin;
+    }
+
+    /// Square selector row coordinates, \returns the first pixel to render
+    int row_coords(SquareShape, int width, int y, float* sats, float* vals) const
+    {
+        square_row_coords(width, y, sats, vals);
+        return 0;
+    }
+
+    /// Triangle selector row coordinates, \returns the first pixel to render
+    int row_coords(TriangleShape, int width, int y, float* sats, float* vals) const
+    {
+        return triangle_row_coords(width, y, sats, vals);
+    }
+
+    /// First pixel to render in row \p y of the square selector
+    int row_begin(SquareShape, int) const
+    {
+        return 0;
+    }
+
+    /// First pixel to render in row \p y of the triangle selector
+    int row_begin(TriangleShape, int y) const
+    {
+        return triangle_map.row_begin[y];
+    }
+
+    /**
+     * \brief Renders the rows in [begin, end) of the selector
+     *
+     * Only touches the given rows of \p out so it can be called concurrently
+     * for disjoint row ranges.
+     */
+    template<class Space, class Shape>
+    void render_rows(qreal selector_hue, int width, int begin, int end, QRgb* out)
+    {
+        render_rows(Space(), Shape(), selector_hue, width, begin, end, out);
+    }
+
+    /// Renders rows for any color space by converting each pixel
+    template<class Space, class Shape>
+    void render_rows(Space, Shape shape, qreal selector_hue, int width, int begin, int end, QRgb* out)
+    {
+        std::vector<float> hues(width, selector_hue);
+        std::vector<float> sats(width);
+        std::vector<float> vals(width);
+
+        for ( int y = begin; y < end; y++ )
+        {
+            int x = row_coords(shape, width, y, sats.data(), vals.data());
+            Space::line(hues.data() + x, sats.data() + x, vals.data() + x,
+                        out + width * y + x, width - x);
+        }
+    }
+
+    /**
+     * \brief Renders rows of the HSV selector
+     *
+     * With a fixed hue each channel is a linear function of the value and
+     * chroma planes, so this doesn't need a full color conversion.
+     * \pre update_hsv_planes() has been called for the current image
+     */
+    template<class Shape>
+    void render_rows(HsvSpace, Shape shape, qreal selector_hue, int width, int begin, int end, QRgb* out)
     {
+        for ( int y = begin; y < end; y++ )
+        {
+            int x = row_begin(shape, y);
+            std::size_t offset = std::size_t(width) * y + x;
+            utils::rgb_line_from_hue(selector_hue, hsv_value_plane.data() + offset,
+                                     hsv_chroma_plane.data() + offset,
+                                     out + offset, width - x);
+        }
+    }
+
+    /// Picks the color functions and the renderer for \p Space and selector_shape
+    template<class Space>
+    void set_color_space()
+    {
+        color_from = &Space::color;
+        rainbow_from_hue = &Space::rainbow;
+        ring_image_from = &render_ring_image<Space>;
         if ( selector_shape == ShapeTriangle )
-            render_triangle();
+            render_selector_rows = &Private::render_rows<Space, TriangleShape>;
         else
-            render_square();
+            render_selector_rows = &Private::render_rows<Space, SquareShape>;
+    }
+
+    /// Picks the color functions and the renderer for color_space and selector_shape
+    void update_renderer()
+    {
+        switch ( color_space )
+        {
+            case ColorHSV:
+                set_color_space<HsvSpace>();
+                break;
+            case ColorHSL:
+                set_color_space<HslSpace>();
+                break;
+            case ColorLCH:
+                set_color_space<LchSpace>();
+                break;
+            case ColorOKLCH:
+                set_color_space<OklchSpace>();
+                break;
+        }
+    }
+
+    /**
+     * \brief Ensures the HSV planes match the current selector image
+     *
+     * hsv_value_plane holds the value of each pixel and hsv_chroma_plane
+     * value * saturation, these don't depend on the hue.
+     */
+    void update_hsv_planes(ShapeEnum shape, const QSizeF& size, const QSize& isize)
+    {
+        if ( hsv_planes_shape == shape && hsv_planes_size == size )
+            return;
+
+        hsv_planes_shape = shape;
+        hsv_planes_size = size;
+
+        int width = isize.width();
+        std::size_t linear_size = std::size_t(width) * isize.height();
+        hsv_value_plane.resize(linear_size);
+        hsv_chroma_plane.resize(linear_size);
+
+        std::vector<float> sats(width);
+        for ( int y = 0; y < isize.height(); y++ )
+        {
+            float* vals = hsv_value_plane.data() + width * y;
+            float* chroma = hsv_chroma_plane.data() + width * y;
+            int x = shape == ShapeTriangle ?
+                row_coords(TriangleShape(), width, y, sats.data(), vals) :
+                row_coords(SquareShape(), width, y, sats.data(), vals);
+            for ( ; x < width; x++ )
+                chroma[x] = vals[x] * sats[x];
+        }
+    }
+
+    /**
+     * \brief Splits \p rows in bands and calls \p render_rows on each of them
+     *
+     * When \p threads allows it, the bands are rendered concurrently
+     * and this waits for all of them to be done.
+     */
+    void render_bands(int rows, int threads, const std::function<void (int, int)>& render_rows)
+    {
+        if ( threads <= 0 )
+            threads = QThread::idealThreadCount();
+        int bands = qMin(threads, rows / min_band_rows);
+        if ( bands <= 1 )
+        {
+            render_rows(0, rows);
+            return;
+        }
+
+        render_pool.setMaxThreadCount(bands - 1);
+        int band_rows = (rows + bands - 1) / bands;
+        for ( int begin = band_rows; begin < rows; begin += band_rows )
+            render_pool.start(new RenderBand(render_rows, begin, qMin(begin + band_rows, rows)));
+        render_rows(0, band_rows);
+        render_pool.waitForDone();
+    }
+
+    /**
+     * \brief Size of the selector image
+     *
+     * Matches the physical size of the selector on screen, scaled down to fit
+     * selector_pixel_budget and divided by preview_downscale.
+     */
+    QSizeF selector_image_size()
+    {
+        QSizeF size = selector_size() * w->devicePixelRatioF();
+        qreal pixels = size.width() * size.height();
+        if ( selector_pixel_budget > 0 && pixels > selector_pixel_budget )
+            size *= qSqrt(selector_pixel_budget / pixels);
+        size /= preview_downscale;
+
+        if ( selector_shape == ShapeTriangle )
+            return size;
+
+        int width = qMax(int(size.width()), 0);
+        return QSizeF(width, width);
+    }
+
+    /// Snapshot of the selector parameters, so it can be rendered on a different thread
+    SelectorJob selector_job(qreal selector_hue)
+    {
+        SelectorJob job;
+        job.hue = selector_hue;
+        job.size = selector_image_size();
+        job.logical_height = selector_size().height();
+        job.shape = selector_shape;
+        job.color_space = color_space;
+        job.render_rows = render_selector_rows;
+        job.threads = render_threads;
+        return job;
+    }
+
+    /**
+     * \brief Renders the selector described by \p job into \p out
+     *
+     * \p out must hold job.image_size() pixels, the shared coordinate maps
+     * are updated as needed so only one render can run at a time.
+     */
+    void render_selector(const SelectorJob& job, QRgb* out)
+    {
+        QSize isize = job.image_size();
+        int width = isize.width();
+
+        if ( job.shape == ShapeTriangle )
+            update_triangle_map(job.size, isize);
+
+        if ( job.color_space == ColorHSV )
+            update_hsv_planes(job.shape, job.size, isize);
+
+        render_bands(isize.height(), job.threads, [this, &job, width, out](int begin, int end) {
+            (this->*job.render_rows)(job.hue, width, begin, end, out);
+        });
+    }
+
+    /// Renders the selector image for the given hue
+    void render_selector_image(qreal selector_hue)
+    {
+        SelectorJob job = selector_job(selector_hue);
+        QSize isize = job.image_size();
+        init_buffer(isize);
+
+        // Tag with the ratio actually rendered so QPainter knows the logical size
+        inner_selector.setDevicePixelRatio(job.pixel_ratio());
+
+        render_selector(job, inner_selector_buffer.data());
+    }
+
+    /**
+     * \brief Updates the inner image that displays the saturation-value selector
+     *
+     * When the cache is enabled, recent images are reused without rendering.
+     * If selector_cache_hue_steps is set, the hue is rounded to it first so
+     * nearby hues share an image.
+     *
+     * With async_render the image is rendered on async_pool and
+     * inner_selector keeps the previous image until selector_rendered().
+     */
+    void render_inner_selector()
+    {
+        bool cache = selector_cache.maxCost() > 0;
+        qreal selector_hue = hue;
+        if ( cache && selector_cache_hue_steps > 0 )
+        {
+            int step = qRound(hue * selector_cache_hue_steps) % selector_cache_hue_steps;
+            selector_hue = qreal(step) / selector_cache_hue_steps;
+        }
+        SelectorCacheKey key{selector_hue, color_space, selector_shape, selector_image_size()};
+
+        if ( cache )
+        {
+            if ( QImage* cached = selector_cache.object(key) )
+            {
+                ++selector_cache_hits;
+                cancel_async_render();
+                inner_selector = *cached;
+                return;
+            }
+        }
+
+        if ( async_render )
+        {
+            render_async(selector_job(selector_hue), key, cache);
+            return;
+        }
+
+        render_selector_image(selector_hue);
+        if ( cache )
+        {
+            ++selector_cache_misses;
+            int cost = inner_selector.bytesPerLine() * inner_selector.height();
+            selector_cache.insert(key, new QImage(inner_selector.copy()), cost);
+        }
+    }
+
+    /// Queues \p job on async_pool, replacing any request that hasn't started yet
+    void render_async(const SelectorJob& job, const SelectorCacheKey& key, bool cache)
+    {
+        // Already being rendered
+        if ( async_pending && job == async_job )
+            return;
+
+        if ( cache )
+            ++selector_cache_misses;
+
+        async_job = job;
+        async_pending = true;
+        int generation = render_generation.fetchAndAddOrdered(1) + 1;
+        async_pool.clear();
+        async_pool.start(new RenderTask([this, job, key, cache, generation]{
+            render_async_job(job, key, cache, generation);
+        }));
+    }
+
+    /**
+     * \brief Renders \p job on async_pool and posts the result to the widget
+     *
+     * Alternates between the images in async_images, writing to an image
+     * still shown by the widget makes a copy of it so they never overlap.
+     */
+    void render_async_job(const SelectorJob& job, const SelectorCacheKey& key, bool cache, int generation)
+    {
+        // A newer request has been made while this one was queued
+        if ( generation != render_generation.loadAcquire() )
+            return;
+
+        QSize isize = job.image_size();
+        async_back = 1 - async_back;
+        QImage& image = async_images[async_back];
+        if ( image.size() != isize )
+            image = QImage(isize, QImage::Format_RGB32);
+
+        render_selector(job, reinterpret_cast<QRgb*>(image.bits()));
+        image.setDevicePixelRatio(job.pixel_ratio());
+        QCoreApplication::postEvent(w, new SelectorRenderedEvent(generation, key, cache, image));
+    }
+
+    /// Shows the result of an asynchronous render, unless it has been superseded
+    void selector_rendered(SelectorRenderedEvent* event)
+    {
+        if ( event->cache && selector_cache.maxCost() > 0 )
+        {
+            int cost = event->image.bytesPerLine() * event->image.height();
+            selector_cache.insert(event->key, new QImage(event->image.copy()), cost);
+        }
+
+        if ( event->generation != render_generation.loadAcquire() )
+            return;
+
+        async_pending = false;
+        inner_selector = event->image;
+        w->update();
+    }
+
+    /// Discards pending asynchronous renders
+    void cancel_async_render()
+    {
+        if ( !async_pending )
+            return;
+        render_generation.fetchAndAddOrdered(1);
+        async_pending = false;
+        async_pool.clear();
+    }
+
+    /// Discards pending asynchronous renders and waits for the running one
+    void wait_async_render()
+    {
+        cancel_async_render();
+        async_pool.waitForDone();
+    }
+
+    /**
+     * \brief Renders the selector at a reduced resolution while dragging
+     *
+     * The full resolution image is rendered by finish_preview(), either
+     * explicitly or after the drag has been idle for a while.
+     * On mouse release it's rendered directly, a preview would be discarded.
+     */
+    void render_preview()
+    {
+        if ( releasing )
+        {
+            render_full();
+            return;
+        }
+
+        if ( progressive_downscale > 1 )
+        {
+            preview_downscale = progressive_downscale;
+            full_render_timer.start();
+        }
+        render_inner_selector();
+    }
+
+    /**
+     * \brief Handles a drag event, deferring it if one has been handled this frame
+     * \returns \b true if the event has been deferred
+     */
+    bool coalesce_move(QMouseEvent* ev)
+    {
+        if ( !coalesce_input || mouse_status == Nothing )
+            return false;
+
+        if ( input_timer.isActive() )
+        {
+            pending_pos = ev->localPos();
+            pending_buttons = ev->buttons();
+            pending_modifiers = ev->modifiers();
+            input_pending = true;
+            return true;
+        }
+
+        input_timer.start(utils::frame_interval(w));
+        return false;
+    }
+
+    /// Sends the latest deferred drag event to the widget
+    void flush_input()
+    {
+        if ( !input_pending )
+            return;
+
+        input_pending = false;
+        QMouseEvent move(QEvent::MouseMove, pending_pos, Qt::NoButton, pending_buttons, pending_modifiers);
+        QCoreApplication::sendEvent(w, &move);
+    }
+
+    /// Discards deferred drag events
+    void cancel_input()
+    {
+        input_timer.stop();
+        input_pending = false;
+    }
+
+    /// Whether the images from before a resize are being scaled
+    bool resizing() const
+    {
+        return resize_timer.isActive();
+    }
+
+    /// Renders the images for the new size once it's stable
+    void finish_resize()
+    {
+        resize_timer.stop();
+        render_ring();
+        render_inner_selector();
+        w->update();
+    }
+
+    /// Renders the selector at full resolution if a preview is being shown
+    void finish_preview()
+    {
+        full_render_timer.stop();
+        if ( preview_downscale != 1 )
+            render_full();
+    }
+
+    /// Renders the selector at full resolution, ending any preview
+    void render_full()
+    {
+        full_render_timer.stop();
+        preview_downscale = 1;
+        render_inner_selector();
+        w->update();
+    }
+
+    /**
+     * \brief Sets the hue or the saturation and value from a point being dragged
+     * \returns \b false if nothing is being dragged
+     */
+    bool pick_color(const QPoint& pos)
+    {
+        if ( mouse_status == DragCircle )
+        {
+            hue = line_to_point(pos).angle()/360.0;
+            return true;
+        }
+
+        if ( mouse_status != DragSquare )
+            return false;
+
+        QLineF glob_mouse_ln = line_to_point(pos);
+        QLineF center_mouse_ln ( QPointF(0,0),
+                                 glob_mouse_ln.p2() - glob_mouse_ln.p1() );
+
+        center_mouse_ln.setAngle(center_mouse_ln.angle()+selector_image_angle());
+        center_mouse_ln.setP2(center_mouse_ln.p2()-selector_image_offset());
+
+        if ( selector_shape == ShapeSquare )
+        {
+            sat = qBound(0.0, center_mouse_ln.x2()/square_size(), 1.0);
+            val = qBound(0.0, center_mouse_ln.y2()/square_size(), 1.0);
+        }
+        else if ( selector_shape == ShapeTriangle )
+        {
+            QPointF pt = center_mouse_ln.p2();
+
+            qreal side = triangle_side();
+            val = qBound(0.0, pt.x() / triangle_height(), 1.0);
+            qreal slice_h = side * val;
+
+            qreal ycenter = side/2;
+            qreal ymin = ycenter-slice_h/2;
+
+            if ( slice_h > 0 )
+                sat = qBound(0.0, (pt.y()-ymin)/slice_h, 1.0);
+        }
+        return true;
     }
 
     /// Offset of the selector image
@@ -219,32 +1010,17 @@ public:
     /// Updates the outer ring that displays the hue selector
     void render_ring()
     {
-        hue_ring = QPixmap(outer_radius()*2,outer_radius()*2);
-        hue_ring.fill(Qt::transparent);
-        QPainter painter(&hue_ring);
-        painter.setRenderHint(QPainter::Antialiasing);
-        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        int outer = outer_radius();
+        qreal dpr = w->devicePixelRatioF();
 
+        // Rings are shared by all the wheels with the same appearance
+        QString key = QStringLiteral("color_widgets::ColorWheel::ring:%1:%2:%3:%4")
+            .arg(outer).arg(wheel_width).arg(int(color_space)).arg(dpr);
+        if ( QPixmapCache::find(key, &hue_ring) )
+            return;
 
-        const int hue_stops = 24;
-        QConicalGradient gradient_hue(0, 0, 0);
-        if ( gradient_hue.stops().size() < hue_stops )
-        {
-            for ( double a = 0; a < 1.0; a+=1.0/(hue_stops-1) )
-            {
-                gradient_hue.setColorAt(a,rainbow_from_hue(a));
-            }
-            gradient_hue.setColorAt(1,rainbow_from_hue(0));
-        }
-
-        painter.translate(outer_radius(),outer_radius());
-
-        painter.setPen(Qt::NoPen);
-        painter.setBrush(QBrush(gradient_hue));
-        painter.drawEllipse(QPointF(0,0),outer_radius(),outer_radius());
-
-        painter.setBrush(Qt::transparent);//palette().background());
-        painter.drawEllipse(QPointF(0,0),inner_radius(),inner_radius());
+        hue_ring = QPixmap::fromImage(ring_image_from(outer, inner_radius(), dpr));
+        QPixmapCache::insert(key, hue_ring);
     }
 
     void set_color(const QColor& c)
@@ -272,6 +1048,14 @@ public:
                 sat = utils::color_chromaF(c);
                 val = utils::color_lumaF(c);
                 break;
+            case ColorOKLCH:
+            {
+                qreal oklch_hue;
+                utils::color_to_oklch(c, oklch_hue, sat, val);
+                if ( oklch_hue >= 0 )
+                    hue = oklch_hue;
+                break;
+            }
         }
     }
 
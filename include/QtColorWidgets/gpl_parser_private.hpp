@@ -0,0 +1,234 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_GPL_PARSER_PRIVATE_HPP
+#define COLOR_WIDGETS_GPL_PARSER_PRIVATE_HPP
+
+#include <cstring>
+#include <QByteArray>
+#include <QColor>
+#include <QString>
+
+namespace color_widgets {
+
+/**
+ * \brief Reads GIMP palettes directly from memory
+ *
+ * Works on a read-only buffer such as a mapped file. Names are returned as
+ * pointers into that buffer, so scanning a file doesn't allocate anything.
+ * Both \\n and \\r\\n line endings are accepted.
+ */
+class GplParser
+{
+public:
+    GplParser(const char* data, qint64 size)
+        : cursor(data), end(data + size)
+    {}
+
+    /**
+     * \brief Reads the magic line and the properties before the colors
+     * \returns \b false if the data isn't a GIMP palette
+     */
+    bool readHeader()
+    {
+        const char* begin;
+        const char* stop;
+        if ( !nextLine(begin, stop) || !equals(begin, stop, "GIMP Palette") )
+            return fail(QStringLiteral("not a GIMP palette"));
+
+        while ( nextLine(begin, stop) )
+        {
+            const char* key = skipSpace(begin, stop);
+            if ( key == stop )
+                continue;
+
+            // Properties end at the first comment or color
+            const char* colon = static_cast<const char*>(std::memchr(key, ':', stop - key));
+            if ( *key == '#' || isDigit(*key) || !colon )
+            {
+                cursor = begin;
+                line_number--;
+                break;
+            }
+
+            const char* value = skipSpace(colon + 1, stop);
+            const char* value_end = trimEnd(value, stop);
+            const char* key_end = trimEnd(key, colon);
+            if ( equalsNoCase(key, key_end, "name") )
+                palette_name = QString::fromUtf8(value, value_end - value);
+            else if ( equalsNoCase(key, key_end, "columns") )
+                palette_columns = QByteArray::fromRawData(value, value_end - value).toInt();
+        }
+        return true;
+    }
+
+    /**
+     * \brief Reads the next color, skipping blank lines and comments
+     * \param name      Set to the start of the color name, within the buffer
+     * \param name_size Set to the size in bytes of the name, which is UTF-8
+     * \returns \b false at the end of the data or on error, see failed()
+     */
+    bool readColor(QRgb& color, const char*& name, int& name_size)
+    {
+        const char* begin;
+        const char* stop;
+        while ( nextLine(begin, stop) )
+        {
+            const char* c = skipSpace(begin, stop);
+            if ( c == stop || *c == '#' )
+                continue;
+
+            int rgb[3];
+            for ( int& component : rgb )
+            {
+                c = skipSpace(c, stop);
+                if ( !readNumber(c, stop, component) )
+                    return fail(QStringLiteral("expected a number between 0 and 255"));
+            }
+            if ( c != stop && !isSpace(*c) )
+                return fail(QStringLiteral("expected a space after the color"));
+
+            name = skipSpace(c, stop);
+            name_size = int(trimEnd(name, stop) - name);
+            color = qRgb(rgb[0], rgb[1], rgb[2]);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * \brief Counts the colors left without parsing them
+     *
+     * Every line that isn't blank or a comment is counted, so invalid colors
+     * are only found by readColor().
+     */
+    int countColors()
+    {
+        int count = 0;
+        const char* begin;
+        const char* stop;
+        while ( nextLine(begin, stop) )
+        {
+            const char* c = skipSpace(begin, stop);
+            if ( c != stop && *c != '#' )
+                count++;
+        }
+        return count;
+    }
+
+    /// Rough number of colors left, to reserve space for them
+    int estimateColors() const
+    {
+        // Lines like "255 128 0 Orange"
+        return int(qMin<qint64>((end - cursor) / 16, 1 << 20));
+    }
+
+    QString name() const { return palette_name; }
+    int columns() const { return palette_columns; }
+
+    bool failed() const { return !error_string.isEmpty(); }
+
+    /// Description of the error, see lineNumber() for where it happened
+    QString errorString() const { return error_string; }
+
+    /// Number of the last line read, starting from 1
+    int lineNumber() const { return line_number; }
+
+private:
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    static const char* skipSpace(const char* begin, const char* stop)
+    {
+        while ( begin != stop && isSpace(*begin) )
+            ++begin;
+        return begin;
+    }
+
+    static const char* trimEnd(const char* begin, const char* stop)
+    {
+        while ( stop != begin && isSpace(stop[-1]) )
+            --stop;
+        return stop;
+    }
+
+    static bool equals(const char* begin, const char* stop, const char* literal)
+    {
+        int size = int(std::strlen(literal));
+        return stop - begin == size && std::memcmp(begin, literal, size) == 0;
+    }
+
+    /// Compares with a lower case \p literal
+    static bool equalsNoCase(const char* begin, const char* stop, const char* literal)
+    {
+        for ( ; begin != stop && *literal; ++begin, ++literal )
+        {
+            char c = *begin >= 'A' && *begin <= 'Z' ? *begin - 'A' + 'a' : *begin;
+            if ( c != *literal )
+                return false;
+        }
+        return begin == stop && !*literal;
+    }
+
+    /// Reads a color component, GIMP clamps values out of range the same way
+    static bool readNumber(const char*& c, const char* stop, int& value)
+    {
+        if ( c == stop || !isDigit(*c) )
+            return false;
+        value = 0;
+        for ( ; c != stop && isDigit(*c); ++c )
+            value = qMin(value * 10 + (*c - '0'), 256);
+        value = qMin(value, 255);
+        return true;
+    }
+
+    /// Moves to the next line, excluding the line terminator from [\p begin, \p stop)
+    bool nextLine(const char*& begin, const char*& stop)
+    {
+        if ( cursor >= end )
+            return false;
+        begin = cursor;
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        stop = newline ? newline : end;
+        cursor = newline ? newline + 1 : end;
+        if ( stop != begin && stop[-1] == '\r' )
+            --stop;
+        line_number++;
+        return true;
+    }
+
+    bool fail(const QString& message)
+    {
+        error_string = message;
+        return false;
+    }
+
+    const char* cursor;
+    const char* end;
+    int line_number = 0;
+    QString error_string;
+    QString palette_name;
+    int palette_columns = 0;
+};
+
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_GPL_PARSER_PRIVATE_HPP
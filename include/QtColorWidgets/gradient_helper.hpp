@@ -23,44 +23,110 @@
 #define GRADIENT_HELPER_HPP
 
 #include "colorwidgets_global.hpp"
+#include "color_utils.hpp"
 
 #include <QGradient>
 
 namespace color_widgets {
 
-inline QColor blendColors(const QColor& a, const QColor& b, qreal ratio)
+/// Color space used to interpolate between two colors
+enum class BlendSpace
 {
-    return QColor::fromRgbF(
-        a.redF()   * (1-ratio) + b.redF()   * ratio,
-        a.greenF() * (1-ratio) + b.greenF() * ratio,
-        a.blueF()  * (1-ratio) + b.blueF()  * ratio,
-        a.alphaF() * (1-ratio) + b.alphaF() * ratio
-    );
+    RGB,    ///< Interpolates the sRGB channels, same as QGradient
+    OKLab,  ///< Perceptually uniform, without the dark or gray midpoints of RGB
+    OKLCH,  ///< Perceptual, keeps chroma by going around the shorter hue arc
+};
+
+/**
+ * \brief Blends two colors, \p ratio is the weight of \p b
+ *
+ * Works on the channels directly, blendColors(const QColor&, const QColor&, qreal, BlendSpace)
+ * converts to this once for each color.
+ */
+inline Rgba32f blendColors(const Rgba32f& a, const Rgba32f& b, qreal ratio, BlendSpace space = BlendSpace::RGB)
+{
+    float t = float(ratio);
+    float alpha = a.a * (1-t) + b.a * t;
+
+    if ( space == BlendSpace::OKLab )
+    {
+        float l1, a1, b1, l2, a2, b2;
+        utils::color_to_oklab(a, l1, a1, b1);
+        utils::color_to_oklab(b, l2, a2, b2);
+        return utils::rgba_from_oklab(
+            l1 * (1-t) + l2 * t,
+            a1 * (1-t) + a2 * t,
+            b1 * (1-t) + b2 * t,
+            alpha
+        );
+    }
+
+    if ( space == BlendSpace::OKLCH )
+    {
+        float h1, c1, l1, h2, c2, l2;
+        utils::color_to_oklch(a, h1, c1, l1);
+        utils::color_to_oklch(b, h2, c2, l2);
+        // Grays have no hue, they take the one of the other color
+        if ( h1 < 0 )
+            h1 = qMax(h2, 0.f);
+        if ( h2 < 0 )
+            h2 = h1;
+        float delta = h2 - h1;
+        if ( delta > 0.5f )
+            delta -= 1;
+        else if ( delta < -0.5f )
+            delta += 1;
+        float hue = h1 + delta * t;
+        if ( hue < 0 )
+            hue += 1;
+        else if ( hue >= 1 )
+            hue -= 1;
+        return utils::rgba_from_oklch(hue, c1 * (1-t) + c2 * t, l1 * (1-t) + l2 * t, alpha);
+    }
+
+    return Rgba32f{
+        a.r * (1-t) + b.r * t,
+        a.g * (1-t) + b.g * t,
+        a.b * (1-t) + b.b * t,
+        alpha
+    };
 }
 
+inline QColor blendColors(const QColor& a, const QColor& b, qreal ratio, BlendSpace space = BlendSpace::RGB)
+{
+    return blendColors(Rgba32f::fromColor(a), Rgba32f::fromColor(b), ratio, space).toColor();
+}
+
+/// Gradient stops holding Rgba32f, accepted by the gradient helpers like QGradientStops
+typedef QPair<qreal, Rgba32f> GradientStop32f;
+typedef QVector<GradientStop32f> GradientStops32f;
+
 
 /**
  * \brief Get an insertion point in the gradient
- * \param gradient  Gradient stops to look into (must be properly set up)
+ * \param gradient  QGradientStops or GradientStops32f to look into (must be properly set up)
  * \param factor    Value in [0, 1] to get the color for
+ * \param space     Color space to blend the stops in
  * \return A pair whose first element is the index to insert the new value at, and a GradientStop
  */
-inline QPair<int, QGradientStop> Q_DECL_EXPORT gradientBlendedColorInsert(const QGradientStops& gradient, qreal factor)
+template<class Color>
+inline QPair<int, QPair<qreal, Color>> gradientBlendedColorInsert(const QVector<QPair<qreal, Color>>& gradient,
+                                                                  qreal factor, BlendSpace space = BlendSpace::RGB)
 {
     if ( gradient.empty() )
-        return {0, {0, QColor()}};
+        return {0, {0, Color()}};
 
     if ( gradient.size() == 1 || factor <= 0 )
         return {0, gradient.front()};
 
     int i = 0;
-    QGradientStop s1;
+    QPair<qreal, Color> s1;
     for ( auto s2 : gradient )
     {
         if ( factor < s2.first )
         {
             qreal ratio = (factor - s1.first) / (s2.first - s1.first);
-            return {i, {factor, blendColors(s1.second, s2.second, ratio)}};
+            return {i, {factor, blendColors(s1.second, s2.second, ratio, space)}};
         }
         s1 = s2;
         ++i;
@@ -73,20 +139,58 @@ inline QPair<int, QGradientStop> Q_DECL_EXPORT gradientBlendedColorInsert(const
  * \brief Returns a color in the gradient
  * \param gradient  Gradient stops to look into (must be properly set up)
  * \param factor    Value in [0, 1] to get the color for
+ * \param space     Color space to blend the stops in
  */
-inline QColor Q_DECL_EXPORT gradientBlendedColor(const QGradientStops& gradient, qreal factor)
+template<class Color>
+inline Color gradientBlendedColor(const QVector<QPair<qreal, Color>>& gradient, qreal factor,
+                                  BlendSpace space = BlendSpace::RGB)
 {
-    return gradientBlendedColorInsert(gradient, factor).second.second;
+    return gradientBlendedColorInsert(gradient, factor, space).second.second;
 }
 
 /**
  * \brief Returns a color in the gradient
  * \param gradient  Gradient to look into
  * \param factor    Value in [0, 1] to get the color for
+ * \param space     Color space to blend the stops in
  */
-inline QColor Q_DECL_EXPORT gradientBlendedColor(const QGradient& gradient, qreal factor)
+inline QColor Q_DECL_EXPORT gradientBlendedColor(const QGradient& gradient, qreal factor,
+                                                 BlendSpace space = BlendSpace::RGB)
 {
-    return gradientBlendedColor(gradient.stops(), factor);
+    return gradientBlendedColor(gradient.stops(), factor, space);
+}
+
+/**
+ * \brief Returns stops that make QGradient, which blends in RGB, look blended in \p space
+ * \param gradient  Gradient stops (must be properly set up)
+ * \param space     Color space to blend the stops in
+ * \param steps     Number of RGB segments replacing each pair of stops
+ */
+template<class Color>
+inline QVector<QPair<qreal, Color>> gradientBlendedStops(const QVector<QPair<qreal, Color>>& gradient,
+                                                         BlendSpace space, int steps = 8)
+{
+    if ( space == BlendSpace::RGB || gradient.size() < 2 || steps < 2 )
+        return gradient;
+
+    QVector<QPair<qreal, Color>> stops;
+    stops.reserve((gradient.size() - 1) * steps + 1);
+    for ( int i = 0; i < gradient.size() - 1; i++ )
+    {
+        const QPair<qreal, Color>& s1 = gradient[i];
+        const QPair<qreal, Color>& s2 = gradient[i+1];
+        stops.push_back(s1);
+        for ( int j = 1; j < steps; j++ )
+        {
+            qreal ratio = qreal(j) / steps;
+            stops.push_back({
+                s1.first + (s2.first - s1.first) * ratio,
+                blendColors(s1.second, s2.second, ratio, space)
+            });
+        }
+    }
+    stops.push_back(gradient.back());
+    return stops;
 }
 
 } // namespace color_widgets
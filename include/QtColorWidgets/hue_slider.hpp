@@ -24,6 +24,7 @@
 #define HUE_SLIDER_HPP
 
 #include "gradient_slider.hpp"
+#include "color_wheel.hpp"
 
 namespace color_widgets {
 
@@ -56,6 +57,14 @@ class QCP_EXPORT HueSlider : public GradientSlider
      */
     Q_PROPERTY(qreal colorHue READ colorHue WRITE setColorHue NOTIFY colorHueChanged)
 
+    /**
+     * \brief Color space of the rainbow
+     *
+     * Saturation and Value stand for the second and third component of the
+     * space, eg: chroma and lightness for OKLCH.
+     */
+    Q_PROPERTY(ColorWheel::ColorSpaceEnum colorSpace READ colorSpace WRITE setColorSpace NOTIFY colorSpaceChanged)
+
 
 public:
     explicit HueSlider(QWidget *parent = nullptr);
@@ -67,6 +76,7 @@ public:
     qreal colorAlpha() const;
     QColor color() const;
     qreal colorHue() const;
+    ColorWheel::ColorSpaceEnum colorSpace() const;
 
 public Q_SLOTS:
     void setColorValue(qreal value);
@@ -81,6 +91,7 @@ public Q_SLOTS:
      * \brief Set Hue Saturation, ColorValue and Alpha
      */
     void setFullColor(const QColor& color);
+    void setColorSpace(ColorWheel::ColorSpaceEnum space);
 
 Q_SIGNALS:
     void colorHueChanged(qreal colorHue);
@@ -88,6 +99,7 @@ Q_SIGNALS:
     void colorAlphaChanged(qreal v);
     void colorSaturationChanged(qreal v);
     void colorValueChanged(qreal v);
+    void colorSpaceChanged(ColorWheel::ColorSpaceEnum space);
 
 private:
     class Private;
@@ -0,0 +1,69 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_OKLAB_PRIVATE_HPP
+#define COLOR_WIDGETS_OKLAB_PRIVATE_HPP
+
+/*
+ * Only depends on the standard library: the batch kernels include it in
+ * translation units built for other instruction sets, see color_utils_batch_kernels.hpp.
+ */
+#include <cmath>
+
+namespace color_widgets {
+namespace utils {
+
+/**
+ * \brief Converts OKLab to linear sRGB
+ * \see https://bottosson.github.io/posts/oklab/
+ */
+template<class T>
+inline void oklab_to_linear_srgb(T lightness, T a, T b, T& red, T& green, T& blue)
+{
+    T l = lightness + T(0.3963377774) * a + T(0.2158037573) * b;
+    T m = lightness - T(0.1055613458) * a - T(0.0638541728) * b;
+    T s = lightness - T(0.0894841775) * a - T(1.2914855480) * b;
+    l = l * l * l;
+    m = m * m * m;
+    s = s * s * s;
+    red   = T( 4.0767416621) * l - T(3.3077115913) * m + T(0.2309699292) * s;
+    green = T(-1.2684380046) * l + T(2.6097574011) * m - T(0.3413193965) * s;
+    blue  = T(-0.0041960863) * l - T(0.7034186147) * m + T(1.7076147010) * s;
+}
+
+/// Converts linear sRGB to OKLab
+template<class T>
+inline void linear_srgb_to_oklab(T red, T green, T blue, T& lightness, T& a, T& b)
+{
+    // Unqualified so vector types can provide their own cube root
+    using std::cbrt;
+    T l = cbrt(T(0.4122214708) * red + T(0.5363325363) * green + T(0.0514459929) * blue);
+    T m = cbrt(T(0.2119034982) * red + T(0.6806995451) * green + T(0.1073969566) * blue);
+    T s = cbrt(T(0.0883024619) * red + T(0.2817188376) * green + T(0.6299787005) * blue);
+    lightness = T(0.2104542553) * l + T(0.7936177850) * m - T(0.0040720468) * s;
+    a = T(1.9779984951) * l - T(2.4285922050) * m + T(0.4505937099) * s;
+    b = T(0.0259040371) * l + T(0.7827717662) * m - T(0.8086757660) * s;
+}
+
+} // namespace utils
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_OKLAB_PRIVATE_HPP
@@ -0,0 +1,77 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_PALETTE_FILE_PRIVATE_HPP
+#define COLOR_WIDGETS_PALETTE_FILE_PRIVATE_HPP
+
+#include <QColor>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+namespace color_widgets {
+
+class ColorPalette;
+
+/**
+ * \brief Contents of a palette file
+ *
+ * Plain data so files can be read from any thread, ColorPalette objects
+ * are then updated with apply() from the thread they live in.
+ */
+class PaletteFileData
+{
+public:
+    /**
+     * \brief Reads a GIMP or binary palette from \p file_name
+     * \param header_only   Only count the colors, without storing them
+     * \returns \b false on failure, see \c error
+     */
+    bool read(const QString& file_name, bool header_only = false);
+
+    /**
+     * \brief Parses a palette already in memory
+     *
+     * \c file_name should be set beforehand, it's used in error messages.
+     */
+    bool parse(const char* data, qint64 size, bool header_only = false);
+
+    /// Replaces the contents of \p palette, as ColorPalette::load() does
+    void apply(ColorPalette& palette) const;
+
+    QString file_name;
+    QString name;
+    int columns = 0;
+    /// Number of colors, also set when they are not stored
+    int count = 0;
+    QVector<QPair<QColor, QString>> colors;
+    /// Whether the file is in the binary format rather than a GIMP palette
+    bool binary = false;
+    QString error;
+
+private:
+    bool parseGpl(const char* data, qint64 size, bool header_only);
+    bool parseBinary(const char* data, qint64 size, bool header_only);
+};
+
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_PALETTE_FILE_PRIVATE_HPP
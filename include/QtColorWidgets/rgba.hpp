@@ -0,0 +1,128 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_RGBA_HPP
+#define COLOR_WIDGETS_RGBA_HPP
+
+#include <QColor>
+
+namespace color_widgets {
+
+/**
+ * \brief Plain 8-bit RGBA color
+ *
+ * Has the same channels as QRgb, for code that shouldn't pay for QColor.
+ */
+struct Rgba8
+{
+    quint8 r;
+    quint8 g;
+    quint8 b;
+    quint8 a;
+
+    static constexpr Rgba8 fromRgba(QRgb rgba)
+    {
+        return Rgba8{quint8(rgba >> 16), quint8(rgba >> 8), quint8(rgba), quint8(rgba >> 24)};
+    }
+
+    constexpr QRgb rgba() const
+    {
+        return (QRgb(a) << 24) | (QRgb(r) << 16) | (QRgb(g) << 8) | QRgb(b);
+    }
+
+    constexpr bool operator==(const Rgba8& o) const
+    {
+        return r == o.r && g == o.g && b == o.b && a == o.a;
+    }
+
+    constexpr bool operator!=(const Rgba8& o) const
+    {
+        return !(*this == o);
+    }
+};
+
+/**
+ * \brief Plain floating point RGBA color, channels are in [0-1]
+ *
+ * QColor converts from its spec on every accessor call, this is converted
+ * once with fromColor() and then read directly.
+ */
+struct Rgba32f
+{
+    float r;
+    float g;
+    float b;
+    float a;
+
+    static constexpr Rgba32f fromRgba8(Rgba8 c)
+    {
+        return Rgba32f{c.r / 255.f, c.g / 255.f, c.b / 255.f, c.a / 255.f};
+    }
+
+    static constexpr Rgba32f fromRgba(QRgb rgba)
+    {
+        return fromRgba8(Rgba8::fromRgba(rgba));
+    }
+
+    static Rgba32f fromColor(const QColor& c)
+    {
+        QRgba64 rgba = c.rgba64();
+        return Rgba32f{rgba.red() / 65535.f, rgba.green() / 65535.f, rgba.blue() / 65535.f, rgba.alpha() / 65535.f};
+    }
+
+    /// Rounds to 8 bits, clamping channels outside [0-1]
+    constexpr Rgba8 toRgba8() const
+    {
+        return Rgba8{channel8(r), channel8(g), channel8(b), channel8(a)};
+    }
+
+    constexpr QRgb rgba() const
+    {
+        return toRgba8().rgba();
+    }
+
+    QColor toColor() const
+    {
+        return QColor::fromRgbF(qBound(0.f, r, 1.f), qBound(0.f, g, 1.f), qBound(0.f, b, 1.f), qBound(0.f, a, 1.f));
+    }
+
+    constexpr bool operator==(const Rgba32f& o) const
+    {
+        return r == o.r && g == o.g && b == o.b && a == o.a;
+    }
+
+    constexpr bool operator!=(const Rgba32f& o) const
+    {
+        return !(*this == o);
+    }
+
+    static constexpr quint8 channel8(float value)
+    {
+        return quint8(qBound(0.f, value, 1.f) * 255 + 0.5f);
+    }
+};
+
+} // namespace color_widgets
+
+Q_DECLARE_TYPEINFO(color_widgets::Rgba8, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(color_widgets::Rgba32f, Q_PRIMITIVE_TYPE);
+
+#endif // COLOR_WIDGETS_RGBA_HPP
@@ -0,0 +1,186 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_SRGB_TABLES_PRIVATE_HPP
+#define COLOR_WIDGETS_SRGB_TABLES_PRIVATE_HPP
+
+#include "QtColorWidgets/color_space_private.hpp"
+
+namespace color_widgets {
+namespace utils {
+
+/*
+ * sRGB transfer function tables, generated by the compiler.
+ *
+ * std::pow isn't constexpr so the tables are built from series expansions
+ * of exp and log, which are exact to double precision in the range used here.
+ */
+namespace srgb_tables {
+
+/// Number of intervals in the encode table, 12 bits of linear precision
+const int encode_steps = 4096;
+
+/// e^x for |x| <= 0.5, \p term is the n-th term of the Taylor series
+constexpr double exp_series(double x, double term, int n)
+{
+    return n > 24 ? term : term + exp_series(x, term * x / (n + 1), n + 1);
+}
+
+constexpr double square(double x)
+{
+    return x * x;
+}
+
+/// e^x, halving \p x until the series converges quickly
+constexpr double exp(double x)
+{
+    return x < -0.5 || x > 0.5 ? square(exp(x / 2)) : exp_series(x, 1, 0);
+}
+
+/// atanh(t) by its series, \p power is t^n and \p t2 is t^2
+constexpr double atanh_series(double t2, double power, int n)
+{
+    return n > 41 ? 0 : power / n + atanh_series(t2, power * t2, n + 2);
+}
+
+/// Natural logarithm of a positive \p x, brought into [0.5, 2] first
+constexpr double log(double x)
+{
+    return x < 0.5 ? log(x * 2) - 0.69314718055994530942 :
+           x > 2   ? log(x / 2) + 0.69314718055994530942 :
+           2 * atanh_series(square((x - 1) / (x + 1)), (x - 1) / (x + 1), 1);
+}
+
+constexpr double pow(double base, double exponent)
+{
+    return base <= 0 ? 0 : exp(exponent * log(base));
+}
+
+/// Same as utils::srgb_decode()
+constexpr double decode(double encoded)
+{
+    return encoded <= 0.04045 ? encoded / 12.92 : pow((encoded + 0.055) / 1.055, 2.4);
+}
+
+/// Same as utils::srgb_encode()
+constexpr double encode(double linear)
+{
+    return linear <= 0.0031308 ? linear * 12.92 : 1.055 * pow(linear, 1 / 2.4) - 0.055;
+}
+
+/*
+ * Compile time index lists, built by halves so the template depth stays
+ * logarithmic in the size of the table.
+ */
+template<int... I> struct IndexList {};
+
+template<class A, class B> struct ConcatIndices;
+template<int... A, int... B>
+struct ConcatIndices<IndexList<A...>, IndexList<B...>>
+{
+    typedef IndexList<A..., int(sizeof...(A)) + B...> type;
+};
+
+template<int N>
+struct MakeIndices
+{
+    typedef typename ConcatIndices<
+        typename MakeIndices<N / 2>::type,
+        typename MakeIndices<N - N / 2>::type
+    >::type type;
+};
+template<> struct MakeIndices<0> { typedef IndexList<> type; };
+template<> struct MakeIndices<1> { typedef IndexList<0> type; };
+
+template<class Indices> struct DecodeTable;
+/// Linear value of each 8-bit channel value
+template<int... I>
+struct DecodeTable<IndexList<I...>>
+{
+    static constexpr float values[sizeof...(I)] = { float(decode(I / 255.0))... };
+};
+template<int... I>
+constexpr float DecodeTable<IndexList<I...>>::values[sizeof...(I)];
+
+template<class Indices> struct EncodeTable;
+/// Encoded value at each step of the linear range, with one extra step for interpolation
+template<int... I>
+struct EncodeTable<IndexList<I...>>
+{
+    static constexpr float values[sizeof...(I)] = { float(encode(double(I) / encode_steps))... };
+};
+template<int... I>
+constexpr float EncodeTable<IndexList<I...>>::values[sizeof...(I)];
+
+typedef DecodeTable<MakeIndices<256>::type> Decode8;
+typedef EncodeTable<MakeIndices<encode_steps + 2>::type> Encode12;
+
+} // namespace srgb_tables
+
+/// Linear value of an 8-bit sRGB channel
+inline float srgb_decode_byte(int value)
+{
+    return srgb_tables::Decode8::values[value];
+}
+
+/**
+ * \brief Linear value of a 16-bit channel as stored by QColor
+ *
+ * Channels set from 8-bit values use the table, others the exact formula.
+ */
+inline float srgb_decode_word(quint16 value)
+{
+    if ( value % 257 == 0 )
+        return srgb_decode_byte(value / 257);
+    return float(srgb_decode(value / 65535.0));
+}
+
+/**
+ * \brief Linear value of an encoded channel in [0-1]
+ *
+ * Channels that came from 8-bit values use the table, others the exact formula.
+ */
+inline float srgb_decode_fast(float encoded)
+{
+    float x = encoded * 255;
+    int i = qRound(x);
+    if ( i >= 0 && i <= 255 && qAbs(x - i) < 1e-4f )
+        return srgb_decode_byte(i);
+    return srgb_decode(encoded);
+}
+
+/**
+ * \brief Encodes a linear value, clamped to [0-1]
+ *
+ * Interpolates the 12-bit table, within 2e-5 of srgb_encode().
+ */
+inline float srgb_encode_fast(float linear)
+{
+    float x = qBound(0.f, linear, 1.f) * srgb_tables::encode_steps;
+    int i = int(x);
+    const float* table = srgb_tables::Encode12::values;
+    return table[i] + (table[i+1] - table[i]) * (x - i);
+}
+
+} // namespace utils
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_SRGB_TABLES_PRIVATE_HPP
@@ -21,66 +21,239 @@
  */
 #include "QtColorWidgets/color_2d_slider.hpp"
 #include "QtColorWidgets/color_utils.hpp"
+#include "QtColorWidgets/color_space_private.hpp"
 #include <QImage>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QResizeEvent>
+#include <QCoreApplication>
+#include <QTimer>
+#include <QCache>
+
+#include <vector>
+#include <algorithm>
 
 namespace color_widgets {
 
 static const double selector_radius = 6;
 
+/**
+ * \brief Identifies a rendered plane in Color2DSlider::Private::plane_cache
+ */
+struct PlaneCacheKey
+{
+    ColorWheel::ColorSpaceEnum color_space;
+    Color2DSlider::Component comp_x;
+    Color2DSlider::Component comp_y;
+    /// Hue, saturation and value quantized to 16 bits, 0 for the ones on the axes
+    quint16 fixed[3];
+    QSize size;
+
+    bool operator==(const PlaneCacheKey& o) const
+    {
+        return color_space == o.color_space && comp_x == o.comp_x && comp_y == o.comp_y && fixed[0] == o.fixed[0] &&
+               fixed[1] == o.fixed[1] && fixed[2] == o.fixed[2] && size == o.size;
+    }
+};
+
+inline uint qHash(const PlaneCacheKey& key, uint seed = 0)
+{
+    quint64 packed = quint64(key.color_space) << 52 | quint64(key.comp_x) << 50 | quint64(key.comp_y) << 48 |
+                     quint64(key.fixed[0]) << 32 | quint64(key.fixed[1]) << 16 |
+                     quint64(key.fixed[2]);
+    return uint(packed ^ (packed >> 32)) ^ uint(key.size.width() << 16 ^ key.size.height()) ^ seed;
+}
+
 class Color2DSlider::Private
 {
 public:
     qreal hue = 1, sat = 1, val = 1;
     Component comp_x = Saturation;
     Component comp_y = Value;
+    ColorWheel::ColorSpaceEnum color_space = ColorWheel::ColorHSV;
+    QColor (*color_from)(qreal,qreal,qreal,qreal) = &HsvSpace::color;
+    void (*components_from)(const QColor&, qreal&, qreal&, qreal&) = &HsvSpace::components;
+    /// Renders the plane, instantiated for color_space
+    void (Private::*render_plane)(const PlaneCacheKey& key, QImage& image) = &Private::renderPlane<HsvSpace>;
     QImage square;
+    /// Whether square shows the current fixed component at the current size
+    bool plane_valid = false;
+    Color2DSlider* w;
+    /// Whether drag events are processed at most once per frame
+    bool coalesce_input = true;
+    /// Running while drag events are being coalesced
+    QTimer input_timer;
+    /// Latest drag event received while input_timer was running
+    bool input_pending = false;
+    QPointF pending_pos;
+    Qt::MouseButtons pending_buttons;
+    Qt::KeyboardModifiers pending_modifiers;
+    /// Milliseconds the size has to be stable before re-rendering
+    int resize_debounce = 100;
+    /// Running while the widget is being resized
+    QTimer resize_timer;
+
+    Private(Color2DSlider* widget)
+        : w(widget)
+    {
+        input_timer.setSingleShot(true);
+        QObject::connect(&input_timer, &QTimer::timeout, [this]{
+            flush_input();
+        });
+        resize_timer.setSingleShot(true);
+        QObject::connect(&resize_timer, &QTimer::timeout, [this]{
+            w->update();
+        });
+    }
+
+    /**
+     * \brief Handles a drag event, deferring it if one has been handled this frame
+     * \returns \b true if the event has been deferred
+     */
+    bool coalesce_move(QMouseEvent* ev)
+    {
+        if ( !coalesce_input || ev->buttons() == Qt::NoButton )
+            return false;
+
+        if ( input_timer.isActive() )
+        {
+            pending_pos = ev->localPos();
+            pending_buttons = ev->buttons();
+            pending_modifiers = ev->modifiers();
+            input_pending = true;
+            return true;
+        }
 
-    qreal PixHue(float x, float y)
+        input_timer.start(utils::frame_interval(w));
+        return false;
+    }
+
+    /// Sends the latest deferred drag event to the widget
+    void flush_input()
     {
-        if ( comp_x == Hue )
-            return x;
-        if ( comp_y == Hue )
-            return y;
-        return hue;
+        if ( !input_pending )
+            return;
+
+        input_pending = false;
+        QMouseEvent move(QEvent::MouseMove, pending_pos, Qt::NoButton, pending_buttons, pending_modifiers);
+        QCoreApplication::sendEvent(w, &move);
     }
 
-    qreal PixSat(float x, float y)
+    /// Discards deferred drag events
+    void cancel_input()
     {
-        if ( comp_x == Saturation )
-            return x;
-        if ( comp_y == Saturation )
-            return y;
-        return sat;
+        input_timer.stop();
+        input_pending = false;
     }
 
-    qreal PixVal(float x, float y)
+    /// Rendered planes, the cost is their size in bytes
+    QCache<PlaneCacheKey, QImage> plane_cache{4 * 1024 * 1024};
+
+    PlaneCacheKey planeKey(const QSize& size) const
     {
-        if ( comp_x == Value )
-            return x;
-        if ( comp_y == Value )
-            return y;
-        return val;
+        PlaneCacheKey key{color_space, comp_x, comp_y, {
+            quint16(qRound(qBound(0.0, hue, 1.0) * 65535)),
+            quint16(qRound(qBound(0.0, sat, 1.0) * 65535)),
+            quint16(qRound(qBound(0.0, val, 1.0) * 65535)),
+        }, size};
+        key.fixed[comp_x] = 0;
+        key.fixed[comp_y] = 0;
+        return key;
+    }
+
+    /**
+     * \brief Renders the plane for \p key into \p image
+     *
+     * Each component is read from an array picked once per render: the x
+     * coordinates, the current row coordinate or the fixed value, so every
+     * scanline is a single batch conversion in \p Space.
+     * Colors out of the RGB gamut are left transparent.
+     */
+    template<class Space>
+    void renderPlane(const PlaneCacheKey& key, QImage& image)
+    {
+        int width = key.size.width();
+        int height = key.size.height();
+
+        std::vector<float> fixed[3];
+        const float* channels[3];
+        for ( int i = 0; i < 3; i++ )
+        {
+            fixed[i].assign(width, key.fixed[i] / 65535.f);
+            channels[i] = fixed[i].data();
+        }
+
+        std::vector<float> axis_x(width);
+        for ( int x = 0; x < width; ++x )
+            axis_x[x] = float(x) / width;
+
+        std::vector<float> axis_y(width);
+        channels[key.comp_y] = axis_y.data();
+        channels[key.comp_x] = axis_x.data();
+
+        for ( int y = 0; y < height; ++y )
+        {
+            std::fill(axis_y.begin(), axis_y.end(), 1 - float(y) / height);
+            Space::masked_line(
+                channels[Hue], channels[Saturation], channels[Value],
+                reinterpret_cast<QRgb*>(image.scanLine(y)),
+                width
+            );
+        }
     }
 
     void renderSquare(const QSize& size)
     {
-        square = QImage(size, QImage::Format_RGB32);
+        PlaneCacheKey key = planeKey(size);
+        if ( QImage* cached = plane_cache.object(key) )
+        {
+            square = *cached;
+            return;
+        }
 
-        for ( int y = 0; y < size.height(); ++y )
+        int cost = size.width() * size.height() * 4;
+        if ( cost > plane_cache.maxCost() )
         {
-            qreal yfloat = 1 - qreal(y) / size.height();
-            for ( int x = 0; x < size.width(); ++x )
-            {
-                qreal xfloat = qreal(x) / size.width();
-                square.setPixel( x, y, QColor::fromHsvF(
-                    PixHue(xfloat, yfloat),
-                    PixSat(xfloat, yfloat),
-                    PixVal(xfloat, yfloat)
-                ).rgb());
-            }
+            // Too big to be cached, render in place unless the cache shares the previous plane
+            if ( square.size() != size || !square.isDetached() )
+                square = QImage(size, QImage::Format_ARGB32_Premultiplied);
+            (this->*render_plane)(key, square);
+            return;
+        }
+
+        // The cache owns the new plane, square only shares it
+        QImage* image = new QImage(size, QImage::Format_ARGB32_Premultiplied);
+        (this->*render_plane)(key, *image);
+        square = *image;
+        plane_cache.insert(key, image, cost);
+    }
+
+    /// Picks the color functions and the renderer for \p Space
+    template<class Space>
+    void setColorSpace()
+    {
+        color_from = &Space::color;
+        components_from = &Space::components;
+        render_plane = &Private::renderPlane<Space>;
+    }
+
+    /// Picks the color functions and the renderer for color_space
+    void updateRenderer()
+    {
+        switch ( color_space )
+        {
+            case ColorWheel::ColorHSV:
+                setColorSpace<HsvSpace>();
+                break;
+            case ColorWheel::ColorHSL:
+                setColorSpace<HslSpace>();
+                break;
+            case ColorWheel::ColorLCH:
+                setColorSpace<LchSpace>();
+                break;
+            case ColorWheel::ColorOKLCH:
+                setColorSpace<OklchSpace>();
+                break;
         }
     }
 
@@ -108,23 +281,77 @@ public:
             qBound(0.0, qreal(pt.x()) / size.width(), 1.0),
             qBound(0.0, 1 - qreal(pt.y()) / size.height(), 1.0)
         );
-        switch ( comp_x )
+        setComponent(comp_x, ptfloat.x());
+        setComponent(comp_y, ptfloat.y());
+    }
+
+    qreal& component(Component comp)
+    {
+        switch ( comp )
         {
-            case Hue:       hue = ptfloat.x(); break;
-            case Saturation:sat = ptfloat.x(); break;
-            case Value:     val = ptfloat.x(); break;
+            case Hue:       return hue;
+            case Saturation:return sat;
+            case Value:     break;
         }
-        switch ( comp_y )
+        return val;
+    }
+
+    /// Sets a component, the plane is only invalidated if it's not on an axis
+    void setComponent(Component comp, qreal value)
+    {
+        qreal& target = component(comp);
+        if ( target == value )
+            return;
+        target = value;
+        if ( comp != comp_x && comp != comp_y )
+            plane_valid = false;
+    }
+
+    /**
+     * \brief Renders the plane if it has been invalidated
+     *
+     * While resizing, a valid plane for the previous size is kept
+     */
+    void ensurePlane(const QSize& size)
+    {
+        bool resized = square.size() != size && !resize_timer.isActive();
+        if ( !plane_valid || square.isNull() || resized )
+        {
+            renderSquare(size);
+            plane_valid = true;
+        }
+    }
+
+    /// Area covered by the selector circle and its outline
+    QRect selectorRect(const QSize& size)
+    {
+        // Pen width and antialiasing
+        qreal radius = selector_radius + 3;
+        return QRectF(selectorPos(size) - QPointF(radius, radius), QSizeF(radius * 2, radius * 2))
+            .toAlignedRect();
+    }
+
+    /**
+     * \brief Schedules a repaint after the color has changed
+     *
+     * If the plane is still valid only the previous and current
+     * selector circles are repainted.
+     */
+    void updateSelector(const QRect& old_selector)
+    {
+        if ( !plane_valid )
         {
-            case Hue:       hue = ptfloat.y(); break;
-            case Saturation:sat = ptfloat.y(); break;
-            case Value:     val = ptfloat.y(); break;
+            w->update();
+            return;
         }
+
+        w->update(old_selector);
+        w->update(selectorRect(w->size()));
     }
 };
 
 Color2DSlider::Color2DSlider(QWidget* parent)
-    : QWidget(parent), p(new Private)
+    : QWidget(parent), p(new Private(this))
 {
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
@@ -136,7 +363,7 @@ Color2DSlider::~Color2DSlider()
 
 QColor Color2DSlider::color() const
 {
-    return QColor::fromHsvF(p->hue, p->sat, p->val);
+    return p->color_from(p->hue, p->sat, p->val, 1);
 }
 
 QSize Color2DSlider::sizeHint() const
@@ -171,35 +398,39 @@ Color2DSlider::Component Color2DSlider::componentY() const
 
 void Color2DSlider::setColor(const QColor& c)
 {
-    p->hue = c.hsvHueF();
-    p->sat = c.saturationF();
-    p->val = c.valueF();
-    p->renderSquare(size());
-    update();
+    QRect old_selector = p->selectorRect(size());
+    qreal h, s, v;
+    p->components_from(c, h, s, v);
+    // Keep the hue for grays
+    if ( h >= 0 )
+        p->setComponent(Hue, h);
+    p->setComponent(Saturation, s);
+    p->setComponent(Value, v);
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
 }
 
 void Color2DSlider::setHue(qreal h)
 {
-    p->hue = h;
-    p->renderSquare(size());
-    update();
+    QRect old_selector = p->selectorRect(size());
+    p->setComponent(Hue, h);
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
 }
 
 void Color2DSlider::setSaturation(qreal s)
 {
-    p->sat = s;
-    p->renderSquare(size());
-    update();
+    QRect old_selector = p->selectorRect(size());
+    p->setComponent(Saturation, s);
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
 }
 
 void Color2DSlider::setValue(qreal v)
 {
-    p->val = v;
-    p->renderSquare(size());
-    update();
+    QRect old_selector = p->selectorRect(size());
+    p->setComponent(Value, v);
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
 }
 
@@ -208,7 +439,7 @@ void Color2DSlider::setComponentX(Color2DSlider::Component componentX)
     if ( componentX != p->comp_x )
     {
         p->comp_x = componentX;
-        p->renderSquare(size());
+        p->plane_valid = false;
         update();
         Q_EMIT componentXChanged(p->comp_x);
     }
@@ -219,17 +450,95 @@ void Color2DSlider::setComponentY(Color2DSlider::Component componentY)
     if ( componentY != p->comp_y )
     {
         p->comp_y = componentY;
-        p->renderSquare(size());
+        p->plane_valid = false;
         update();
         Q_EMIT componentXChanged(p->comp_y);
     }
 }
 
-void Color2DSlider::paintEvent(QPaintEvent*)
+ColorWheel::ColorSpaceEnum Color2DSlider::colorSpace() const
+{
+    return p->color_space;
+}
+
+void Color2DSlider::setColorSpace(ColorWheel::ColorSpaceEnum space)
+{
+    if ( space != p->color_space )
+    {
+        QColor old_color = color();
+        p->color_space = space;
+        p->updateRenderer();
+
+        qreal h;
+        p->components_from(old_color, h, p->sat, p->val);
+        if ( h >= 0 )
+            p->hue = h;
+
+        p->plane_valid = false;
+        update();
+        Q_EMIT colorSpaceChanged(space);
+    }
+}
+
+int Color2DSlider::resizeDebounce() const
 {
+    return p->resize_debounce;
+}
+
+void Color2DSlider::setResizeDebounce(int msecs)
+{
+    msecs = qMax(msecs, 0);
+    if ( msecs != p->resize_debounce )
+    {
+        p->resize_debounce = msecs;
+        if ( p->resize_timer.isActive() )
+        {
+            p->resize_timer.stop();
+            update();
+        }
+        Q_EMIT resizeDebounceChanged(msecs);
+    }
+}
+
+bool Color2DSlider::coalesceInput() const
+{
+    return p->coalesce_input;
+}
+
+void Color2DSlider::setCoalesceInput(bool coalesce)
+{
+    if ( coalesce != p->coalesce_input )
+    {
+        p->coalesce_input = coalesce;
+        if ( !coalesce )
+        {
+            p->input_timer.stop();
+            p->flush_input();
+        }
+        Q_EMIT coalesceInputChanged(coalesce);
+    }
+}
+
+bool Color2DSlider::event(QEvent* event)
+{
+    if ( event->type() == QEvent::MouseMove && p->coalesce_move(static_cast<QMouseEvent*>(event)) )
+    {
+        event->accept();
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+void Color2DSlider::paintEvent(QPaintEvent* event)
+{
+    p->ensurePlane(size());
+
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
-    painter.drawImage(0,0,p->square);
+    if ( p->square.size() == size() )
+        painter.drawImage(event->rect(), p->square, event->rect());
+    else
+        painter.drawImage(rect(), p->square);
 
     painter.setPen(QPen(p->val > 0.5 ? Qt::black : Qt::white, 3));
     painter.setBrush(Qt::NoBrush);
@@ -238,28 +547,35 @@ void Color2DSlider::paintEvent(QPaintEvent*)
 
 void Color2DSlider::mousePressEvent(QMouseEvent* event)
 {
+    QRect old_selector = p->selectorRect(size());
     p->setColorFromPos(event->pos(), size());
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
-    update();
 }
 
 void Color2DSlider::mouseMoveEvent(QMouseEvent* event)
 {
+    QRect old_selector = p->selectorRect(size());
     p->setColorFromPos(event->pos(), size());
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
-    update();
 }
 
 void Color2DSlider::mouseReleaseEvent(QMouseEvent* event)
 {
+    // The release position supersedes any deferred move
+    p->cancel_input();
+    QRect old_selector = p->selectorRect(size());
     p->setColorFromPos(event->pos(), size());
+    p->updateSelector(old_selector);
     Q_EMIT colorChanged(color());
-    update();
 }
 
-void Color2DSlider::resizeEvent(QResizeEvent* event)
+void Color2DSlider::resizeEvent(QResizeEvent*)
 {
-    p->renderSquare(event->size());
+    // Keep showing the old plane until the size settles
+    if ( p->resize_debounce > 0 && !p->square.isNull() )
+        p->resize_timer.start(p->resize_debounce);
     update();
 }
 
@@ -20,6 +20,9 @@
  *
  */
 #include "QtColorWidgets/color_palette.hpp"
+#include "QtColorWidgets/binary_palette_private.hpp"
+#include "QtColorWidgets/gpl_parser_private.hpp"
+#include "QtColorWidgets/palette_file_private.hpp"
 #include <cmath>
 #include <QFile>
 #include <QTextStream>
@@ -37,6 +40,9 @@ public:
     QString         name;
     QString         fileName;
     bool            dirty;
+    QString         error;
+    /// Whether the file is in the binary format rather than a GIMP palette
+    bool            binary = false;
 
     bool valid_index(int index)
     {
@@ -185,74 +191,15 @@ ColorPalette ColorPalette::fromImage(const QImage& image)
 
 bool ColorPalette::load(const QString& name)
 {
-    p->fileName = name;
-    p->colors.clear();
-    p->columns = 0;
-    p->dirty = false;
-    p->name = QFileInfo(name).baseName();
-
-    QFile file(name);
-
-    if ( !file.open(QFile::ReadOnly|QFile::Text) )
-    {
-        emitUpdate();
-        return false;
-    }
-
-    QTextStream stream( &file );
-
-    if ( stream.readLine() != QLatin1String("GIMP Palette") )
-    {
-        emitUpdate();
-        return false;
-    }
-
-    QString line;
-
-    // parse properties
-    QHash<QString,QString> properties;
-    while( !stream.atEnd() )
-    {
-        line = stream.readLine();
-        if ( line.isEmpty() )
-            continue;
-        if ( line[0] == '#' )
-            break;
-        int colon = line.indexOf(':');
-        if ( colon == -1 )
-            break;
-        properties[line.left(colon).toLower()] =
-            line.right(line.size() - colon - 1).trimmed();
-    }
-    /// \todo Store extra properties in the palette object
-    setName(properties[QStringLiteral("name")]);
-    setColumns(properties[QStringLiteral("columns")].toInt());
-
-    // Skip comments
-    if ( !stream.atEnd() && line[0] == '#' )
-        while( !stream.atEnd() )
-        {
-            qint64 pos = stream.pos();
-            line = stream.readLine();
-            if ( !line.isEmpty() && line[0] != '#' )
-            {
-                stream.seek(pos);
-                break;
-            }
-        }
-
-    while( !stream.atEnd() )
-    {
-        int r = 0, g = 0, b = 0;
-        stream >> r >> g >> b;
-        line = stream.readLine().trimmed();
-        p->colors.push_back(qMakePair(QColor(r, g, b), line));
-    }
-
-    Q_EMIT colorsChanged(p->colors);
-    setDirty(false);
+    PaletteFileData data;
+    bool loaded = data.read(name);
+    data.apply(*this);
+    return loaded;
+}
 
-    return true;
+QString ColorPalette::errorString() const
+{
+    return p->error;
 }
 
 ColorPalette ColorPalette::fromFile(const QString& name)
@@ -265,6 +212,7 @@ ColorPalette ColorPalette::fromFile(const QString& name)
 bool ColorPalette::save(const QString& filename)
 {
     setFileName(filename);
+    p->binary = QFileInfo(filename).suffix().compare(QLatin1String("qpal"), Qt::CaseInsensitive) == 0;
     return save();
 }
 
@@ -276,6 +224,16 @@ bool ColorPalette::save()
         filename = unnamed(p->name)+".gpl";
     }
 
+    if ( p->binary )
+    {
+        QFile file(filename);
+        QByteArray data = binary_palette::write(unnamed(p->name), p->columns, p->colors);
+        if ( !file.open(QFile::WriteOnly) || file.write(data) != data.size() )
+            return false;
+        setDirty(false);
+        return true;
+    }
+
     QFile file(filename);
     if ( !file.open(QFile::Text|QFile::WriteOnly) )
         return false;
@@ -495,4 +453,119 @@ ColorPalette ColorPalette::fromColorTable(const QVector<QRgb>& table)
     return palette;
 }
 
+
+bool PaletteFileData::read(const QString& file_name, bool header_only)
+{
+    this->file_name = file_name;
+    name = QFileInfo(file_name).baseName();
+    columns = 0;
+    count = 0;
+    colors.clear();
+    binary = false;
+    error.clear();
+
+    QFile file(file_name);
+
+    if ( !file.open(QFile::ReadOnly) )
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    // Parse the mapped file in place, files that can't be mapped are read in a buffer
+    QByteArray buffer;
+    qint64 size = file.size();
+    const char* data = reinterpret_cast<const char*>(file.map(0, size));
+    if ( !data )
+    {
+        buffer = file.readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+
+    return parse(data, size, header_only);
+}
+
+bool PaletteFileData::parse(const char* data, qint64 size, bool header_only)
+{
+    binary = binary_palette::matches(data, size);
+    if ( !(binary ? parseBinary(data, size, header_only) : parseGpl(data, size, header_only)) )
+    {
+        colors.clear();
+        count = 0;
+        return false;
+    }
+    return true;
+}
+
+bool PaletteFileData::parseGpl(const char* data, qint64 size, bool header_only)
+{
+    GplParser parser(data, size);
+    if ( parser.readHeader() )
+    {
+        name = parser.name();
+        columns = qMax(parser.columns(), 0);
+
+        if ( header_only )
+        {
+            count = parser.countColors();
+        }
+        else
+        {
+            colors.reserve(parser.estimateColors());
+            QRgb color;
+            const char* color_name;
+            int name_size;
+            while ( parser.readColor(color, color_name, name_size) )
+                colors.push_back(qMakePair(QColor(color), QString::fromUtf8(color_name, name_size)));
+            count = colors.size();
+        }
+    }
+
+    if ( parser.failed() )
+    {
+        error = ColorPalette::tr("%1:%2: %3").arg(file_name).arg(parser.lineNumber()).arg(parser.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool PaletteFileData::parseBinary(const char* data, qint64 size, bool header_only)
+{
+    binary_palette::View view;
+    if ( !view.open(data, size) )
+    {
+        error = ColorPalette::tr("%1: %2").arg(file_name).arg(view.errorString());
+        return false;
+    }
+
+    name = view.name();
+    columns = view.columns();
+    count = view.count();
+    if ( header_only )
+        return true;
+
+    const QRgb* rgba = view.colors();
+    colors.reserve(view.count());
+    for ( int i = 0; i < view.count(); i++ )
+    {
+        int name_size;
+        const char* color_name = view.colorName(i, name_size);
+        colors.push_back(qMakePair(QColor::fromRgba(rgba[i]), QString::fromUtf8(color_name, name_size)));
+    }
+    return true;
+}
+
+void PaletteFileData::apply(ColorPalette& palette) const
+{
+    palette.p->fileName = file_name;
+    palette.p->name = name;
+    palette.p->columns = columns;
+    palette.p->colors = colors;
+    palette.p->binary = binary;
+    palette.p->error = error;
+    palette.p->dirty = false;
+    palette.emitUpdate();
+}
+
 } // namespace color_widgets
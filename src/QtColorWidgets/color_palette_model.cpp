@@ -20,24 +20,536 @@
  *
  */
 #include "QtColorWidgets/color_palette_model.hpp"
+#include "QtColorWidgets/binary_palette_private.hpp"
+#include "QtColorWidgets/palette_file_private.hpp"
+#include <list>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QEvent>
+#include <QFile>
+#include <QHash>
 #include <QList>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
 
 namespace color_widgets {
 
+/**
+ * \brief Palette in the model, with lazy loading its colors are read when needed
+ */
+class PaletteEntry
+{
+public:
+    PaletteEntry() = default;
+
+    explicit PaletteEntry(const ColorPalette& palette)
+        : palette(palette), count(palette.count()), loaded(true)
+    {}
+
+    /// Palette read by PaletteFileData, created from the thread of the model
+    PaletteEntry(const PaletteFileData& data, bool header_only)
+        : count(data.count), loaded(!header_only), evictable(true)
+    {
+        data.apply(palette);
+    }
+
+    /// Reads the colors if only the header has been loaded
+    void ensureLoaded()
+    {
+        // A file that no longer loads keeps what load() left, without retrying on every use
+        if ( !loaded )
+        {
+            evictable = palette.load(palette.fileName());
+            count = palette.count();
+        }
+        loaded = true;
+    }
+
+    /// Drops the colors, keeping the name, columns and file name
+    void evict()
+    {
+        ColorPalette header(palette.name());
+        header.setColumns(palette.columns());
+        header.setFileName(palette.fileName());
+        header.setDirty(false);
+        palette = header;
+        loaded = false;
+    }
+
+    ColorPalette palette;
+    /// Number of colors, known before they are loaded
+    int count = 0;
+    /// Whether \c palette has its colors
+    bool loaded = false;
+    /// Whether the colors are the same as in the file, so they can be read again
+    bool evictable = false;
+    /// Whether the entry is in ColorPaletteModel::Private::recently_used
+    bool in_recently_used = false;
+    std::list<PaletteEntry*>::iterator recently_used_position;
+};
+
+/**
+ * \brief Palettes found by the last load, kept in the save path
+ *
+ * Files are identified by their canonical path, size and modification time,
+ * unchanged ones are restored from here instead of being parsed again.
+ * Colors are stored in the binary palette format, they are left out for
+ * palettes that were loaded lazily.
+ */
+class PaletteIndexCache
+{
+public:
+    struct Item
+    {
+        qint64 size = 0;
+        qint64 modified = 0;
+        QString name;
+        qint32 columns = 0;
+        qint32 count = 0;
+        /// Whether the file is a binary palette
+        bool binary = false;
+        /// Colors as written by binary_palette::write(), empty if not loaded
+        QByteArray body;
+    };
+
+    static QString fileName(const QString& directory)
+    {
+        return QDir(directory).absoluteFilePath(QStringLiteral("palettes.cache"));
+    }
+
+    /// Reads the cache from \p file_name, on failure it's left empty
+    bool read(const QString& file_name)
+    {
+        items.clear();
+        QFile file(file_name);
+        if ( !file.open(QFile::ReadOnly) )
+            return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        quint32 file_magic = 0, file_version = 0, size = 0;
+        stream >> file_magic >> file_version >> size;
+        if ( file_magic != magic || file_version != version )
+            return false;
+
+        for ( quint32 i = 0; i < size && stream.status() == QDataStream::Ok; i++ )
+        {
+            QString key;
+            Item item;
+            stream >> key >> item.size >> item.modified >> item.name >> item.columns >> item.count
+                   >> item.binary >> item.body;
+            items.insert(key, item);
+        }
+
+        if ( stream.status() != QDataStream::Ok )
+        {
+            items.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /// Replaces \p file_name, other processes see either the old cache or the new one
+    bool write(const QString& file_name) const
+    {
+        QSaveFile file(file_name);
+        if ( !file.open(QFile::WriteOnly) )
+            return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << magic << version << quint32(items.size());
+        for ( auto it = items.begin(); it != items.end(); ++it )
+            stream << it.key() << it->size << it->modified << it->name << it->columns << it->count
+                   << it->binary << it->body;
+
+        return stream.status() == QDataStream::Ok && file.commit();
+    }
+
+    QHash<QString, Item> items;
+
+private:
+    static const quint32 magic = 0x51435049; // QCPI
+    static const quint32 version = 2;
+};
+
+class PaletteLoadJob;
+
+/**
+ * \brief Posted to the model as files are loaded by ColorPaletteModel::loadAsync()
+ */
+class PaletteLoadEvent : public QEvent
+{
+public:
+    PaletteLoadEvent(PaletteLoadJob* job, int done, bool stopped = false)
+        : QEvent(event_type()), job(job), done(done), stopped(stopped)
+    {}
+
+    static QEvent::Type event_type()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+    PaletteLoadJob* job;
+    int done;       ///< Number of files loaded when the event was posted
+    bool stopped;   ///< Whether all the threads of the job have stopped
+};
+
+/**
+ * \brief Palette files being loaded, shared by the threads loading them
+ *
+ * Each thread takes the next file until none are left, results are stored
+ * by index so they keep the order of the files.
+ * Threads only produce PaletteFileData, the palettes are created from the
+ * thread of the model by results().
+ */
+class PaletteLoadJob
+{
+public:
+    /**
+     * \param receiver If not null, PaletteLoadEvent are posted to it as files
+     *                 are loaded and when the threads have stopped
+     */
+    PaletteLoadJob(const QFileInfoList& files, bool lazy, QObject* receiver = nullptr)
+        : files(files), lazy(lazy), receiver(receiver),
+          data(files.size()), bodies(files.size()), loaded(files.size(), 0), restored(files.size(), 0)
+    {}
+
+    /**
+     * \brief Takes unchanged files from \p cache, so run() doesn't parse them
+     *
+     * Without \c lazy only the files with colors in the cache are restored.
+     */
+    void restore(const PaletteIndexCache& cache)
+    {
+        keys.reserve(files.size());
+        int restored_count = 0;
+        for ( int i = 0; i < files.size(); i++ )
+        {
+            const QFileInfo& file = files[i];
+            keys.push_back(file.canonicalFilePath());
+            auto item = cache.items.constFind(keys.back());
+            if ( item != cache.items.constEnd() && item->size == file.size() &&
+                    item->modified == file.lastModified().toMSecsSinceEpoch() &&
+                    (lazy || !item->body.isEmpty()) )
+            {
+                PaletteFileData& header = data[i];
+                header.file_name = file.absoluteFilePath();
+                header.name = item->name;
+                header.columns = item->columns;
+                header.count = item->count;
+                header.binary = item->binary;
+                bodies[i] = item->body;
+                loaded[i] = restored[i] = 1;
+                restored_count++;
+            }
+        }
+        cache_stale = restored_count != cache.items.size();
+        cached = true;
+    }
+
+    /**
+     * \brief Whether the cache passed to restore() needs updating
+     * \pre All the files have been loaded
+     */
+    bool cacheChanged() const
+    {
+        if ( !cached )
+            return false;
+        if ( cache_stale )
+            return true;
+        for ( int i = 0; i < files.size(); i++ )
+            if ( loaded[i] && !restored[i] )
+                return true;
+        return false;
+    }
+
+    /**
+     * \brief Writes the headers of the loaded palettes to \p file_name
+     * \pre All the files have been loaded and restore() has been called
+     */
+    bool writeCache(const QString& file_name) const
+    {
+        PaletteIndexCache cache;
+        for ( int i = 0; i < files.size(); i++ )
+        {
+            if ( !loaded[i] )
+                continue;
+
+            PaletteIndexCache::Item item;
+            item.size = files[i].size();
+            item.modified = files[i].lastModified().toMSecsSinceEpoch();
+            item.name = data[i].name;
+            item.columns = data[i].columns;
+            item.count = data[i].count;
+            item.binary = data[i].binary;
+            if ( restored[i] )
+                item.body = bodies[i];
+            else if ( !lazy )
+                item.body = binary_palette::write(data[i].name, data[i].columns, data[i].colors);
+            cache.items.insert(keys[i], item);
+        }
+
+        return cache.write(file_name);
+    }
+
+    /// Loads files until all of them have been taken
+    void run()
+    {
+        int index;
+        while ( !cancelled.loadAcquire() && (index = next.fetchAndAddRelaxed(1)) < files.size() )
+        {
+            if ( restored[index] && !lazy )
+                restoreColors(index);
+            else if ( !restored[index] )
+                loaded[index] = data[index].read(files[index].absoluteFilePath(), lazy);
+            int done_count = done.fetchAndAddOrdered(1) + 1;
+            if ( receiver )
+                QCoreApplication::postEvent(receiver, new PaletteLoadEvent(this, done_count));
+        }
+    }
+
+    /// Reads the colors of a restored file from its cached body, or from the file if that fails
+    void restoreColors(int index)
+    {
+        PaletteFileData& palette = data[index];
+        bool binary = palette.binary;
+        if ( palette.parse(bodies[index].constData(), bodies[index].size()) )
+        {
+            palette.binary = binary;
+            return;
+        }
+
+        restored[index] = 0;
+        bodies[index].clear();
+        loaded[index] = palette.read(files[index].absoluteFilePath());
+    }
+
+    /// Called by each thread after run(), the last one tells the receiver the job can be deleted
+    void finishThread()
+    {
+        if ( !threads.deref() && receiver )
+            QCoreApplication::postEvent(receiver, new PaletteLoadEvent(this, done.loadAcquire(), true));
+    }
+
+    int total() const
+    {
+        return files.size();
+    }
+
+    /**
+     * \brief Palettes loaded successfully, in the same order as the files
+     * \note Creates QObjects, so it must be called from the thread of the model
+     */
+    QList<PaletteEntry> results() const
+    {
+        QList<PaletteEntry> result;
+        for ( int i = 0; i < data.size(); i++ )
+            if ( loaded[i] )
+                result.push_back(PaletteEntry(data[i], lazy));
+        return result;
+    }
+
+    QAtomicInt cancelled;
+    /// Number of threads that haven't called finishThread() yet
+    QAtomicInt threads;
+
+private:
+    QFileInfoList files;
+    bool lazy;
+    QObject* receiver;
+    QVector<PaletteFileData> data;
+    /// Colors from the cache for restored files
+    QVector<QByteArray> bodies;
+    QVector<char> loaded;
+    QVector<char> restored;
+    /// Canonical paths of the files, set by restore()
+    QStringList keys;
+    bool cached = false;
+    bool cache_stale = false;
+    QAtomicInt next;
+    QAtomicInt done;
+};
+
+/**
+ * \brief Runs PaletteLoadJob::run() from a thread pool
+ *
+ * The job is owned by the model, which deletes it once all the tasks are done.
+ */
+class PaletteLoadTask : public QRunnable
+{
+public:
+    explicit PaletteLoadTask(PaletteLoadJob* job)
+        : job(job)
+    {}
+
+    void run() Q_DECL_OVERRIDE
+    {
+        job->run();
+        job->finishThread();
+    }
+
+private:
+    PaletteLoadJob* job;
+};
+
 class ColorPaletteModel::Private
 {
 public:
     /// \todo Keep sorted by name (?)
-    QList<ColorPalette> palettes;
+    QList<PaletteEntry> palettes;
     QSize icon_size;
     QStringList search_paths;
     QString     save_path;
+    bool lazy_loading = false;
+    int max_loaded = 0;
+    bool index_cache = false;
+    /**
+     * \brief Entries with colors loaded on demand, most recently used first
+     *
+     * Holds pointers into \c palettes, QList keeps its items at the same
+     * address so they only need removing when the entries are removed.
+     */
+    std::list<PaletteEntry*> recently_used;
+    /// Job started by loadAsync(), until it's finished or superseded
+    PaletteLoadJob* async_job = nullptr;
+    int async_progress = 0;
+    /// Jobs started by loadAsync() with threads still running
+    QList<PaletteLoadJob*> jobs;
+    QThreadPool load_pool;
 
     Private()
         : icon_size(32, 32)
-    {}
+    {
+        load_pool.setMaxThreadCount(QThread::idealThreadCount());
+    }
+
+    ~Private()
+    {
+        load_pool.waitForDone();
+        qDeleteAll(jobs);
+    }
+
+    /// Palette files in the search paths, sorted by name within each one
+    QFileInfoList paletteFiles() const
+    {
+        QFileInfoList files;
+        QStringList filters;
+        filters << QStringLiteral("*.gpl") << QStringLiteral("*.qpal");
+        for ( const QString& directory_name : search_paths )
+        {
+            QDir directory(directory_name);
+            directory.setNameFilters(filters);
+            directory.setFilter(QDir::Files|QDir::Readable);
+            directory.setSorting(QDir::Name);
+            files += directory.entryInfoList();
+        }
+        return files;
+    }
+
+    /// Starts up to \p threads threads on \p job, no more than the number of files
+    int startLoad(PaletteLoadJob* job, int threads)
+    {
+        threads = qMax(qMin(threads, job->total()), 0);
+        job->threads.fetchAndAddOrdered(threads);
+        for ( int i = 0; i < threads; i++ )
+            load_pool.start(new PaletteLoadTask(job));
+        return threads;
+    }
+
+    /// Restores unchanged files from the index cache
+    void restoreCache(PaletteLoadJob& job) const
+    {
+        if ( index_cache && !save_path.isEmpty() )
+        {
+            PaletteIndexCache cache;
+            cache.read(PaletteIndexCache::fileName(save_path));
+            job.restore(cache);
+        }
+    }
+
+    /// Updates the index cache after \p job has loaded all the files
+    void writeCache(const PaletteLoadJob& job)
+    {
+        if ( !index_cache || !job.cacheChanged() )
+            return;
+
+        QDir save_dir(save_path);
+        if ( !save_dir.exists() && !QDir().mkdir(save_path) )
+            return;
+        job.writeCache(PaletteIndexCache::fileName(save_path));
+    }
+
+    /// Palette at \p index with its colors loaded
+    const ColorPalette& use(int index)
+    {
+        PaletteEntry& entry = palettes[index];
+        if ( entry.in_recently_used )
+        {
+            recently_used.splice(recently_used.begin(), recently_used, entry.recently_used_position);
+        }
+        else if ( !entry.loaded )
+        {
+            entry.ensureLoaded();
+            if ( entry.evictable )
+            {
+                recently_used.push_front(&entry);
+                entry.recently_used_position = recently_used.begin();
+                entry.in_recently_used = true;
+                evict();
+            }
+        }
+        return entry.palette;
+    }
+
+    /// Drops the least recently used colors until at most max_loaded palettes have them
+    void evict()
+    {
+        if ( max_loaded <= 0 )
+            return;
+
+        while ( int(recently_used.size()) > max_loaded )
+        {
+            PaletteEntry* oldest = recently_used.back();
+            recently_used.pop_back();
+            oldest->in_recently_used = false;
+            oldest->evict();
+        }
+    }
+
+    /// Must be called before \p entry is removed or replaced
+    void forget(PaletteEntry& entry)
+    {
+        if ( entry.in_recently_used )
+        {
+            recently_used.erase(entry.recently_used_position);
+            entry.in_recently_used = false;
+        }
+    }
+
+    /// Replaces all the palettes
+    void reset(const QList<PaletteEntry>& entries)
+    {
+        recently_used.clear();
+        palettes = entries;
+    }
+
+    /// Stops the threads of the loadAsync() job, its results are discarded
+    void cancelAsyncLoad()
+    {
+        if ( async_job )
+        {
+            async_job->cancelled.storeRelease(1);
+            async_job = nullptr;
+        }
+    }
 
     bool acceptable(const QModelIndex& index) const
     {
@@ -49,11 +561,11 @@ public:
         return row >= 0 && row <= palettes.count();
     }
 
-    QList<ColorPalette>::iterator find(const QString& name)
+    QList<PaletteEntry>::iterator find(const QString& name)
     {
         return std::find_if(palettes.begin(), palettes.end(),
-            [&name](const ColorPalette& palette) {
-                return palette.name() == name;
+            [&name](const PaletteEntry& entry) {
+                return entry.palette.name() == name;
         });
     }
 
@@ -120,6 +632,7 @@ ColorPaletteModel::ColorPaletteModel()
 
 ColorPaletteModel::~ColorPaletteModel()
 {
+    p->cancelAsyncLoad();
     delete p;
 }
 
@@ -133,15 +646,15 @@ QVariant ColorPaletteModel::data(const QModelIndex &index, int role) const
     if ( !p->acceptable(index) )
         return QVariant();
 
-    const ColorPalette& palette = p->palettes[index.row()];
+    const PaletteEntry& entry = p->palettes[index.row()];
     switch( role )
     {
         case Qt::DisplayRole:
-            return palette.name();
+            return entry.palette.name();
         case Qt::DecorationRole:
-            return palette.preview(p->icon_size);
+            return p->use(index.row()).preview(p->icon_size);
         case Qt::ToolTipRole:
-            return tr("%1 (%2 colors)").arg(palette.name()).arg(palette.count());
+            return tr("%1 (%2 colors)").arg(entry.palette.name()).arg(entry.count);
     }
 
     return QVariant();
@@ -158,11 +671,13 @@ bool ColorPaletteModel::removeRows(int row, int count, const QModelIndex & paren
     auto end = row + count >= p->palettes.size() ? p->palettes.end() : begin + count;
     for ( auto it = begin; it != end; ++it )
     {
-        if ( !it->fileName().isEmpty() )
+        p->forget(*it);
+        const QString& file_name = it->palette.fileName();
+        if ( !file_name.isEmpty() )
         {
-            QFileInfo file(it->fileName());
+            QFileInfo file(file_name);
             if ( file.isWritable() && file.isFile() )
-                QFile::remove(it->fileName());
+                QFile::remove(file_name);
         }
     }
 
@@ -215,28 +730,121 @@ void ColorPaletteModel::addSearchPath(const QString& path)
     }
 }
 
+bool ColorPaletteModel::lazyLoading() const
+{
+    return p->lazy_loading;
+}
+
+void ColorPaletteModel::setLazyLoading(bool lazyLoading)
+{
+    if ( p->lazy_loading != lazyLoading )
+        Q_EMIT lazyLoadingChanged( p->lazy_loading = lazyLoading );
+}
+
+int ColorPaletteModel::maxLoadedPalettes() const
+{
+    return p->max_loaded;
+}
+
+void ColorPaletteModel::setMaxLoadedPalettes(int maxLoadedPalettes)
+{
+    maxLoadedPalettes = qMax(maxLoadedPalettes, 0);
+    if ( p->max_loaded != maxLoadedPalettes )
+    {
+        p->max_loaded = maxLoadedPalettes;
+        p->evict();
+        Q_EMIT maxLoadedPalettesChanged(maxLoadedPalettes);
+    }
+}
+
+bool ColorPaletteModel::indexCache() const
+{
+    return p->index_cache;
+}
+
+void ColorPaletteModel::setIndexCache(bool indexCache)
+{
+    if ( p->index_cache != indexCache )
+        Q_EMIT indexCacheChanged( p->index_cache = indexCache );
+}
+
 void ColorPaletteModel::load()
 {
+    p->cancelAsyncLoad();
+
+    // The GUI thread loads files as well instead of waiting idle
+    PaletteLoadJob job(p->paletteFiles(), p->lazy_loading);
+    p->restoreCache(job);
+    p->startLoad(&job, p->load_pool.maxThreadCount() - 1);
+    job.run();
+    p->load_pool.waitForDone();
+
     beginResetModel();
-    p->palettes.clear();
-    QStringList filters;
-    filters << QStringLiteral("*.gpl");
-    for ( const QString& directory_name : p->search_paths )
-    {
-        QDir directory(directory_name);
-        directory.setNameFilters(filters);
-        directory.setFilter(QDir::Files|QDir::Readable);
-        directory.setSorting(QDir::Name);
-        for ( const QFileInfo& file : directory.entryInfoList() )
+    p->reset(job.results());
+    endResetModel();
+
+    p->writeCache(job);
+}
+
+void ColorPaletteModel::loadAsync()
+{
+    p->cancelAsyncLoad();
+
+    PaletteLoadJob* job = new PaletteLoadJob(p->paletteFiles(), p->lazy_loading, this);
+    p->restoreCache(*job);
+    p->jobs.push_back(job);
+    p->async_job = job;
+    p->async_progress = 0;
+
+    // Without files there are no threads to post the events
+    if ( p->startLoad(job, p->load_pool.maxThreadCount()) == 0 )
+    {
+        QCoreApplication::postEvent(this, new PaletteLoadEvent(job, 0));
+        QCoreApplication::postEvent(this, new PaletteLoadEvent(job, 0, true));
+    }
+}
+
+bool ColorPaletteModel::isLoading() const
+{
+    return p->async_job;
+}
+
+bool ColorPaletteModel::event(QEvent* event)
+{
+    if ( event->type() == PaletteLoadEvent::event_type() )
+    {
+        auto load_event = static_cast<PaletteLoadEvent*>(event);
+        PaletteLoadJob* job = load_event->job;
+
+        // Deleted here rather than by its last thread, after all its other events
+        if ( load_event->stopped )
         {
-            ColorPalette palette;
-            if ( palette.load(file.absoluteFilePath()) )
-            {
-                p->palettes.push_back(palette);
-            }
+            p->jobs.removeOne(job);
+            delete job;
+            return true;
+        }
+
+        // Superseded by another call to load() or loadAsync()
+        if ( job != p->async_job )
+            return true;
+
+        // Events from different threads can arrive out of order
+        if ( load_event->done > p->async_progress )
+            Q_EMIT loadProgress(p->async_progress = load_event->done, job->total());
+
+        if ( load_event->done == job->total() )
+        {
+            beginResetModel();
+            p->reset(job->results());
+            endResetModel();
+            p->writeCache(*job);
+            p->async_job = nullptr;
+            Q_EMIT loadFinished();
         }
+        return true;
     }
-    endResetModel();
+
+    return QAbstractListModel::event(event);
 }
 
 bool ColorPaletteModel::hasPalette(const QString& name) const
@@ -251,12 +859,12 @@ int ColorPaletteModel::count() const
 
 const ColorPalette& ColorPaletteModel::palette(const QString& name) const
 {
-    return *p->find(name);
+    return p->use(p->find(name) - p->palettes.begin());
 }
 
 const ColorPalette& ColorPaletteModel::palette(int index) const
 {
-    return p->palettes[index];
+    return p->use(index);
 }
 
 bool ColorPaletteModel::updatePalette(int index, const ColorPalette& palette, bool save)
@@ -265,9 +873,10 @@ bool ColorPaletteModel::updatePalette(int index, const ColorPalette& palette, bo
         return false;
 
     // Store the old file name
-    QString filename = p->palettes[index].fileName();
+    QString filename = p->palettes[index].palette.fileName();
     // Update the palette
-    ColorPalette& local_palette = p->palettes[index] = palette;
+    p->forget(p->palettes[index]);
+    ColorPalette& local_palette = (p->palettes[index] = PaletteEntry(palette)).palette;
     p->fixUnnamed(local_palette);
 
     Q_EMIT dataChanged(this->index(index), this->index(index));
@@ -283,9 +892,10 @@ bool ColorPaletteModel::removePalette(int index, bool remove_file)
     if ( !p->acceptable(index) )
         return false;
 
-    QString file_name = p->palettes[index].fileName();
+    QString file_name = p->palettes[index].palette.fileName();
 
     beginRemoveRows(QModelIndex(), index, index);
+    p->forget(p->palettes[index]);
     p->palettes.removeAt(index);
     endRemoveRows();
 
@@ -303,12 +913,12 @@ bool ColorPaletteModel::removePalette(int index, bool remove_file)
 bool ColorPaletteModel::addPalette(const ColorPalette& palette,  bool save)
 {
     beginInsertRows(QModelIndex(), p->palettes.size(), p->palettes.size());
-    p->palettes.push_back(palette);
-    p->fixUnnamed(p->palettes.back());
+    p->palettes.push_back(PaletteEntry(palette));
+    p->fixUnnamed(p->palettes.back().palette);
     endInsertRows();
 
     if ( save )
-        return p->save(p->palettes.back());
+        return p->save(p->palettes.back().palette);
 
     return true;
 }
@@ -318,10 +928,11 @@ int ColorPaletteModel::indexFromFile(const QString& filename) const
 {
     QString canonical = QFileInfo(filename).canonicalFilePath();
     int i = 0;
-    for ( const auto& pal : p->palettes )
+    for ( const auto& entry : p->palettes )
     {
-        if ( !pal.fileName().isEmpty() &&
-                QFileInfo(pal.fileName()).canonicalFilePath() == canonical )
+        const QString& file_name = entry.palette.fileName();
+        if ( !file_name.isEmpty() &&
+                QFileInfo(file_name).canonicalFilePath() == canonical )
             return i;
         i++;
     }
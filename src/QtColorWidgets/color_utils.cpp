@@ -20,11 +20,39 @@
  *
  */
 #include "QtColorWidgets/color_utils.hpp"
+#include "QtColorWidgets/color_space_private.hpp"
+#include "QtColorWidgets/srgb_tables_private.hpp"
 
 #include <QScreen>
 #include <QDesktopWidget>
 #include <QApplication>
+#include <QWindow>
 
+namespace color_widgets {
+namespace utils {
+namespace {
+
+/// Polar form of OKLab, with the same ranges as color_to_oklch()
+template<class T>
+void oklab_to_oklch(T a, T b, T& hue, T& chroma)
+{
+    chroma = qMin<T>(std::hypot(a, b) / T(oklch_max_chroma), 1);
+    // Grays are a few ulps off the neutral axis
+    if ( chroma < T(1e-4) )
+    {
+        chroma = 0;
+        hue = -1;
+        return;
+    }
+
+    hue = std::atan2(b, a) / T(2 * M_PI);
+    if ( hue < 0 )
+        hue += 1;
+}
+
+} // namespace
+} // namespace utils
+} // namespace color_widgets
 
 QColor color_widgets::utils::color_from_lch(qreal hue, qreal chroma, qreal luma, qreal alpha )
 {
@@ -55,32 +83,96 @@ QColor color_widgets::utils::color_from_lch(qreal hue, qreal chroma, qreal luma,
 
 QColor color_widgets::utils::color_from_hsl(qreal hue, qreal sat, qreal lig, qreal alpha )
 {
-    qreal chroma = (1 - qAbs(2*lig-1))*sat;
-    qreal h1 = hue*6;
-    qreal x = chroma*(1-qAbs(std::fmod(h1,2)-1));
-    QColor col;
-    if ( h1 >= 0 && h1 < 1 )
-        col = QColor::fromRgbF(chroma,x,0);
-    else if ( h1 < 2 )
-        col = QColor::fromRgbF(x,chroma,0);
-    else if ( h1 < 3 )
-        col = QColor::fromRgbF(0,chroma,x);
-    else if ( h1 < 4 )
-        col = QColor::fromRgbF(0,x,chroma);
-    else if ( h1 < 5 )
-        col = QColor::fromRgbF(x,0,chroma);
-    else if ( h1 < 6 )
-        col = QColor::fromRgbF(chroma,0,x);
+    quint32 red, green, blue;
+    fixed_hsl_to_rgb<65535>(
+        quint16(qRound64(hue * 65536)),
+        quint16(qRound(qBound(0.0, sat, 1.0) * 65535)),
+        quint16(qRound(qBound(0.0, lig, 1.0) * 65535)),
+        red, green, blue
+    );
+    return QColor::fromRgba64(red, green, blue, qRound(qBound(0.0, alpha, 1.0) * 65535));
+}
 
-    qreal m = lig-chroma/2;
+QRgb color_widgets::utils::rgb_from_hsv16(quint16 hue, quint16 sat, quint16 val)
+{
+    quint32 red, green, blue;
+    fixed_hsv_to_rgb<255>(hue, sat, val, red, green, blue);
+    return qRgb(red, green, blue);
+}
 
-    return QColor::fromRgbF(
-        qBound(0.0,col.redF()+m,1.0),
-        qBound(0.0,col.greenF()+m,1.0),
-        qBound(0.0,col.blueF()+m,1.0),
-        alpha);
+void color_widgets::utils::rgb_to_hsv16(QRgb rgb, quint16& hue, quint16& sat, quint16& val)
+{
+    fixed_rgb_to_hsv<255>(qRed(rgb), qGreen(rgb), qBlue(rgb), hue, sat, val);
 }
 
+QRgb color_widgets::utils::rgb_from_hsl16(quint16 hue, quint16 sat, quint16 lig)
+{
+    quint32 red, green, blue;
+    fixed_hsl_to_rgb<255>(hue, sat, lig, red, green, blue);
+    return qRgb(red, green, blue);
+}
+
+void color_widgets::utils::rgb_to_hsl16(QRgb rgb, quint16& hue, quint16& sat, quint16& lig)
+{
+    fixed_rgb_to_hsl<255>(qRed(rgb), qGreen(rgb), qBlue(rgb), hue, sat, lig);
+}
+
+
+QColor color_widgets::utils::color_from_oklch(qreal hue, qreal chroma, qreal lightness, qreal alpha )
+{
+    qreal angle = hue * 2 * M_PI;
+    qreal c = chroma * oklch_max_chroma;
+    return color_from_oklab(lightness, c * std::cos(angle), c * std::sin(angle), alpha);
+}
+
+void color_widgets::utils::color_to_oklch(const QColor& c, qreal& hue, qreal& chroma, qreal& lightness)
+{
+    qreal a, b;
+    color_to_oklab(c, lightness, a, b);
+    oklab_to_oklch(a, b, hue, chroma);
+}
+
+color_widgets::Rgba32f color_widgets::utils::rgba_from_oklch(float hue, float chroma, float lightness, float alpha)
+{
+    float angle = hue * float(2 * M_PI);
+    float c = chroma * float(oklch_max_chroma);
+    return rgba_from_oklab(lightness, c * std::cos(angle), c * std::sin(angle), alpha);
+}
+
+void color_widgets::utils::color_to_oklch(const Rgba32f& c, float& hue, float& chroma, float& lightness)
+{
+    float a, b;
+    color_to_oklab(c, lightness, a, b);
+    oklab_to_oklch(a, b, hue, chroma);
+}
+
+QColor color_widgets::utils::color_from_oklab(qreal lightness, qreal a, qreal b, qreal alpha)
+{
+    qreal red, green, blue;
+    oklab_to_linear_srgb(lightness, a, b, red, green, blue);
+    return QColor::fromRgbF(srgb_encode_fast(red), srgb_encode_fast(green), srgb_encode_fast(blue), alpha);
+}
+
+void color_widgets::utils::color_to_oklab(const QColor& c, qreal& lightness, qreal& a, qreal& b)
+{
+    auto rgba = c.rgba64();
+    linear_srgb_to_oklab<qreal>(
+        srgb_decode_word(rgba.red()), srgb_decode_word(rgba.green()), srgb_decode_word(rgba.blue()),
+        lightness, a, b
+    );
+}
+
+color_widgets::Rgba32f color_widgets::utils::rgba_from_oklab(float lightness, float a, float b, float alpha)
+{
+    float red, green, blue;
+    oklab_to_linear_srgb(lightness, a, b, red, green, blue);
+    return Rgba32f{srgb_encode_fast(red), srgb_encode_fast(green), srgb_encode_fast(blue), alpha};
+}
+
+void color_widgets::utils::color_to_oklab(const Rgba32f& c, float& lightness, float& a, float& b)
+{
+    linear_srgb_to_oklab(srgb_decode_fast(c.r), srgb_decode_fast(c.g), srgb_decode_fast(c.b), lightness, a, b);
+}
 
 QColor color_widgets::utils::get_screen_color(const QPoint &global_pos)
 {
@@ -96,3 +188,15 @@ QColor color_widgets::utils::get_screen_color(const QPoint &global_pos)
 
     return img.pixel(0,0);
 }
+
+int color_widgets::utils::frame_interval(const QWidget* widget)
+{
+    QScreen* screen = nullptr;
+    if ( QWindow* window = widget->window()->windowHandle() )
+        screen = window->screen();
+    if ( !screen )
+        screen = QGuiApplication::primaryScreen();
+
+    qreal rate = screen ? screen->refreshRate() : 60;
+    return qMax(1, qRound(1000 / qMax<qreal>(rate, 1)));
+}
@@ -0,0 +1,245 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "QtColorWidgets/color_utils.hpp"
+#include "QtColorWidgets/color_space_private.hpp"
+#include "color_utils_batch_kernels.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <intrin.h>
+#endif
+
+namespace color_widgets {
+namespace utils {
+
+static_assert(batch_hsv == int(BatchColorSpace::HSV) && batch_hsl == int(BatchColorSpace::HSL) &&
+              batch_lch == int(BatchColorSpace::LCH) && batch_cielab == int(BatchColorSpace::CIELab) &&
+              batch_oklab == int(BatchColorSpace::OKLab), "Kernel indices must match BatchColorSpace");
+
+namespace {
+
+/// Pixels converted at a time by the interleaved conversions, small enough to stay in cache
+const int batch_block = 256;
+
+/// Whether both the CPU and the OS support AVX2
+bool cpu_has_avx2()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if ( info[0] < 7 )
+        return false;
+    // OSXSAVE and AVX, then check the OS saves the YMM registers
+    __cpuid(info, 1);
+    const int osxsave_avx = (1 << 27) | (1 << 28);
+    if ( (info[2] & osxsave_avx) != osxsave_avx || (_xgetbv(0) & 6) != 6 )
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return false;
+#endif
+}
+
+const BatchKernels& batch_kernels()
+{
+    // avx2_batch_kernels() is compiled with AVX2 enabled, even its static
+    // initializer uses AVX2 instructions: it must never be called on a CPU
+    // without AVX2, so the CPU check has to come first
+    static const BatchKernels* kernels = cpu_has_avx2() && avx2_batch_kernels()
+        ? avx2_batch_kernels() : baseline_batch_kernels();
+    return *kernels;
+}
+
+void deinterleave(const float* in, float* c0, float* c1, float* c2, int count)
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        c0[i] = in[3*i];
+        c1[i] = in[3*i+1];
+        c2[i] = in[3*i+2];
+    }
+}
+
+void interleave(const float* c0, const float* c1, const float* c2, float* out, int count)
+{
+    for ( int i = 0; i < count; i++ )
+    {
+        out[3*i] = c0[i];
+        out[3*i+1] = c1[i];
+        out[3*i+2] = c2[i];
+    }
+}
+
+/// Converts interleaved triplets one block at a time with a planar kernel
+void convert_interleaved(BatchPlanarKernel kernel, const float* in, float* out, int count)
+{
+    float c0[batch_block], c1[batch_block], c2[batch_block];
+    for ( int start = 0; start < count; start += batch_block )
+    {
+        int n = qMin(batch_block, count - start);
+        deinterleave(in + 3*start, c0, c1, c2, n);
+        kernel(c0, c1, c2, n);
+        interleave(c0, c1, c2, out + 3*start, n);
+    }
+}
+
+} // namespace
+
+const BatchKernels* baseline_batch_kernels()
+{
+#if defined(QTCOLORWIDGETS_AVX2)
+    static const BatchKernels kernels = make_batch_kernels("avx2");
+#elif defined(QTCOLORWIDGETS_SSE2)
+    static const BatchKernels kernels = make_batch_kernels("sse2");
+#elif defined(QTCOLORWIDGETS_NEON)
+    static const BatchKernels kernels = make_batch_kernels("neon");
+#else
+    static const BatchKernels kernels = make_batch_kernels("scalar");
+#endif
+    return &kernels;
+}
+
+const char* batch_instruction_set()
+{
+    return batch_kernels().name;
+}
+
+void convert_from_rgb(BatchColorSpace space, const float* rgb, float* out, int count)
+{
+    convert_interleaved(batch_kernels().from_rgb[int(space)], rgb, out, count);
+}
+
+void convert_to_rgb(BatchColorSpace space, const float* in, float* rgb, int count)
+{
+    convert_interleaved(batch_kernels().to_rgb[int(space)], in, rgb, count);
+}
+
+void convert_from_rgb(BatchColorSpace space, const QRgb* rgb, float* out, int count)
+{
+    BatchPlanarKernel kernel = batch_kernels().from_rgb[int(space)];
+    float c0[batch_block], c1[batch_block], c2[batch_block];
+    for ( int start = 0; start < count; start += batch_block )
+    {
+        int n = qMin(batch_block, count - start);
+        for ( int i = 0; i < n; i++ )
+        {
+            QRgb c = rgb[start+i];
+            c0[i] = qRed(c) / 255.f;
+            c1[i] = qGreen(c) / 255.f;
+            c2[i] = qBlue(c) / 255.f;
+        }
+        kernel(c0, c1, c2, n);
+        interleave(c0, c1, c2, out + 3*start, n);
+    }
+}
+
+void convert_to_rgb(BatchColorSpace space, const float* in, QRgb* rgb, int count)
+{
+    BatchLineKernel kernel = batch_kernels().to_packed[int(space)];
+    float c0[batch_block], c1[batch_block], c2[batch_block];
+    for ( int start = 0; start < count; start += batch_block )
+    {
+        int n = qMin(batch_block, count - start);
+        deinterleave(in + 3*start, c0, c1, c2, n);
+        kernel(c0, c1, c2, rgb + start, n);
+    }
+}
+
+bool convert_from_rgb(BatchColorSpace space, const QRgb* rgb, quint16* out, int count)
+{
+    if ( space != BatchColorSpace::HSV && space != BatchColorSpace::HSL )
+        return false;
+    auto convert = space == BatchColorSpace::HSL ? &fixed_rgb_to_hsl<255> : &fixed_rgb_to_hsv<255>;
+    for ( int i = 0; i < count; i++ )
+        convert(qRed(rgb[i]), qGreen(rgb[i]), qBlue(rgb[i]), out[3*i], out[3*i+1], out[3*i+2]);
+    return true;
+}
+
+bool convert_to_rgb(BatchColorSpace space, const quint16* in, QRgb* rgb, int count)
+{
+    if ( space != BatchColorSpace::HSV && space != BatchColorSpace::HSL )
+        return false;
+    auto convert = space == BatchColorSpace::HSL ? &fixed_hsl_to_rgb<255> : &fixed_hsv_to_rgb<255>;
+    for ( int i = 0; i < count; i++ )
+    {
+        quint32 r, g, b;
+        convert(in[3*i], in[3*i+1], in[3*i+2], r, g, b);
+        rgb[i] = qRgb(r, g, b);
+    }
+    return true;
+}
+
+void rgb_line_from_hue(qreal hue, const float* top, const float* chroma, QRgb* out, int count)
+{
+    FloatX1 h6 = float(hue * 6);
+    float falloff[3] = {
+        hue_falloff(h6, 5).v,
+        hue_falloff(h6, 3).v,
+        hue_falloff(h6, 1).v,
+    };
+    batch_kernels().hue_line(falloff, top, chroma, out, count);
+}
+
+void rgb_line_from_hsv(const float* hue, const float* sat, const float* val, QRgb* out, int count)
+{
+    batch_kernels().to_packed[int(BatchColorSpace::HSV)](hue, sat, val, out, count);
+}
+
+void rgb_line_from_hsl(const float* hue, const float* sat, const float* lig, QRgb* out, int count)
+{
+    batch_kernels().to_packed[int(BatchColorSpace::HSL)](hue, sat, lig, out, count);
+}
+
+void rgb_line_from_lch(const float* hue, const float* chroma, const float* luma, QRgb* out, int count,
+                       bool mask_gamut)
+{
+    const BatchKernels& kernels = batch_kernels();
+    int index = int(BatchColorSpace::LCH);
+    (mask_gamut ? kernels.to_packed_masked : kernels.to_packed)[index](hue, chroma, luma, out, count);
+}
+
+void rgb_line_from_oklch(const float* hue, const float* chroma, const float* lightness, QRgb* out, int count,
+                         bool mask_gamut)
+{
+    // Only the polar to cartesian step is scalar, the rest goes through the OKLab kernel
+    const BatchKernels& kernels = batch_kernels();
+    BatchLineKernel kernel = (mask_gamut ? kernels.to_packed_masked : kernels.to_packed)[int(BatchColorSpace::OKLab)];
+    float a[batch_block], b[batch_block];
+    for ( int start = 0; start < count; start += batch_block )
+    {
+        int n = qMin(batch_block, count - start);
+        for ( int i = 0; i < n; i++ )
+        {
+            float angle = hue[start+i] * float(2 * M_PI);
+            float c = chroma[start+i] * float(oklch_max_chroma);
+            a[i] = c * std::cos(angle);
+            b[i] = c * std::sin(angle);
+        }
+        kernel(lightness + start, a, b, out + start, n);
+    }
+}
+
+} // namespace utils
+} // namespace color_widgets
@@ -0,0 +1,46 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Built with AVX2 enabled by CMake, so any code in here can use AVX2
+ * instructions: nothing in this file may run before cpu_has_avx2() has
+ * confirmed the CPU supports it.
+ * Without the flag, as in the qmake build, it provides no kernels.
+ * Only include the kernel header here, see color_utils_batch_kernels.hpp.
+ */
+#include "color_utils_batch_kernels.hpp"
+
+namespace color_widgets {
+namespace utils {
+
+const BatchKernels* avx2_batch_kernels()
+{
+#ifdef QTCOLORWIDGETS_AVX2
+    static const BatchKernels kernels = make_batch_kernels("avx2");
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace utils
+} // namespace color_widgets
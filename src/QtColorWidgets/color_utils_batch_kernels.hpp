@@ -0,0 +1,814 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef COLOR_WIDGETS_COLOR_UTILS_BATCH_KERNELS_HPP
+#define COLOR_WIDGETS_COLOR_UTILS_BATCH_KERNELS_HPP
+
+/*
+ * This header is compiled with different instruction sets, see
+ * color_utils_batch_avx2.cpp. It must only include headers whose inline
+ * functions aren't used here, or the linker could pick the AVX2 copy of one
+ * of them for the whole library. In particular it doesn't include color_utils.hpp.
+ */
+#include <QtGlobal>
+#include <QRgb>
+
+#include "QtColorWidgets/oklab_private.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define QTCOLORWIDGETS_SSE2
+#   include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#   define QTCOLORWIDGETS_NEON
+#   include <arm_neon.h>
+#endif
+
+#if defined(__AVX2__)
+#   define QTCOLORWIDGETS_AVX2
+#   include <immintrin.h>
+#endif
+
+namespace color_widgets {
+namespace utils {
+
+/// Number of values in BatchColorSpace
+const int batch_color_spaces = 5;
+
+/// Indices in the BatchKernels arrays, with the values of BatchColorSpace
+const int batch_hsv = 0;
+const int batch_hsl = 1;
+const int batch_lch = 2;
+const int batch_cielab = 3;
+const int batch_oklab = 4;
+
+/// Converts planar components in place
+typedef void (*BatchPlanarKernel)(float* c0, float* c1, float* c2, int count);
+/// Converts planar components to packed RGB
+typedef void (*BatchLineKernel)(const float* c0, const float* c1, const float* c2, QRgb* out, int count);
+
+/**
+ * \brief Conversion kernels compiled for a given instruction set
+ *
+ * Arrays are indexed by BatchColorSpace.
+ */
+struct BatchKernels
+{
+    const char* name;
+    BatchPlanarKernel to_rgb[batch_color_spaces];
+    BatchPlanarKernel from_rgb[batch_color_spaces];
+    BatchLineKernel to_packed[batch_color_spaces];
+    /// Same as to_packed but colors out of gamut are transparent
+    BatchLineKernel to_packed_masked[batch_color_spaces];
+    void (*hue_line)(const float* falloff, const float* top, const float* chroma, QRgb* out, int count);
+};
+
+/// Kernels for the instruction sets the compiler targets by default
+const BatchKernels* baseline_batch_kernels();
+
+/// Kernels built with AVX2 enabled, null if the build didn't enable it
+const BatchKernels* avx2_batch_kernels();
+
+/*
+ * Everything below has internal linkage: this header is compiled once
+ * per instruction set and the instances must not be merged by the linker.
+ */
+namespace {
+
+/*
+ * The conversions below are written once against a tiny vector interface,
+ * implemented by FloatX1 (plain floats), FloatX4 (SSE2 or NEON) and FloatX8 (AVX2).
+ *
+ * exponent(), mantissa() and exp2i() only deal with positive normal floats,
+ * they are the building blocks for fast_log2() and the like.
+ */
+
+/// How far out of [0-1] a channel can be and still round to a valid byte
+const float gamut_epsilon = .5f / 255;
+
+/// Same as M_LN2 and M_SQRT2, which need qmath.h on some compilers
+const double ln2 = 0.69314718055994530942;
+const double sqrt2 = 1.41421356237309504880;
+
+template<class Vec> Vec fast_cbrt(Vec x);
+
+struct FloatX1
+{
+    static const int width = 1;
+    typedef bool Mask;
+    float v;
+
+    FloatX1() {}
+    FloatX1(float v) : v(v) {}
+
+    static FloatX1 load(const float* p) { return *p; }
+    void store(float* p) const { *p = v; }
+
+    friend FloatX1 operator+(FloatX1 a, FloatX1 b) { return a.v + b.v; }
+    friend FloatX1 operator-(FloatX1 a, FloatX1 b) { return a.v - b.v; }
+    friend FloatX1 operator*(FloatX1 a, FloatX1 b) { return a.v * b.v; }
+    friend FloatX1 operator/(FloatX1 a, FloatX1 b) { return a.v / b.v; }
+    friend FloatX1 min(FloatX1 a, FloatX1 b) { return a.v < b.v ? a.v : b.v; }
+    friend FloatX1 max(FloatX1 a, FloatX1 b) { return a.v > b.v ? a.v : b.v; }
+    /// Subtracts \p period from \p a unless it's already below it
+    friend FloatX1 wrap(FloatX1 a, FloatX1 period) { return a.v >= period.v ? a.v - period.v : a.v; }
+
+    friend Mask operator<(FloatX1 a, FloatX1 b) { return a.v < b.v; }
+    friend Mask operator<=(FloatX1 a, FloatX1 b) { return a.v <= b.v; }
+    friend Mask operator>(FloatX1 a, FloatX1 b) { return a.v > b.v; }
+    friend Mask operator==(FloatX1 a, FloatX1 b) { return a.v == b.v; }
+    friend FloatX1 select(Mask m, FloatX1 a, FloatX1 b) { return m ? a : b; }
+
+    /// Truncates and fixes up negative values, std::floor() would be an external function
+    friend FloatX1 floor(FloatX1 a)
+    {
+        float t = float(int(a.v));
+        return t > a.v ? t - 1 : t;
+    }
+    /// Unbiased binary exponent
+    friend FloatX1 exponent(FloatX1 a) { return float(int(bits(a) >> 23) - 127); }
+    /// \p a with its exponent set to 0, in [1, 2)
+    friend FloatX1 mantissa(FloatX1 a) { return from_bits((bits(a) & 0x007fffffu) | 0x3f800000u); }
+    /// 2 to the power of the integer \p n
+    friend FloatX1 exp2i(FloatX1 n) { return from_bits(quint32(int(n.v) + 127) << 23); }
+    friend FloatX1 cbrt(FloatX1 a) { return fast_cbrt(a); }
+
+    static quint32 bits(FloatX1 a)
+    {
+        quint32 b;
+        std::memcpy(&b, &a.v, sizeof(b));
+        return b;
+    }
+
+    static FloatX1 from_bits(quint32 b)
+    {
+        float f;
+        std::memcpy(&f, &b, sizeof(f));
+        return f;
+    }
+
+    static QRgb to_byte(FloatX1 a)
+    {
+        return QRgb(max(FloatX1(0), min(a, 1)).v * 255.f + .5f);
+    }
+
+    static void store_rgb(QRgb* out, FloatX1 r, FloatX1 g, FloatX1 b)
+    {
+        *out = 0xff000000u | (to_byte(r) << 16) | (to_byte(g) << 8) | to_byte(b);
+    }
+
+    /// Same as store_rgb() but out of gamut colors are stored as transparent
+    static void store_rgb_masked(QRgb* out, FloatX1 r, FloatX1 g, FloatX1 b)
+    {
+        if ( min(r, min(g, b)).v >= -gamut_epsilon && max(r, max(g, b)).v <= 1 + gamut_epsilon )
+            store_rgb(out, r, g, b);
+        else
+            *out = 0;
+    }
+};
+
+#ifdef QTCOLORWIDGETS_SSE2
+struct FloatX4
+{
+    static const int width = 4;
+    typedef __m128 Mask;
+    __m128 v;
+
+    FloatX4() {}
+    FloatX4(__m128 v) : v(v) {}
+    FloatX4(float f) : v(_mm_set1_ps(f)) {}
+
+    static FloatX4 load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend FloatX4 operator+(FloatX4 a, FloatX4 b) { return _mm_add_ps(a.v, b.v); }
+    friend FloatX4 operator-(FloatX4 a, FloatX4 b) { return _mm_sub_ps(a.v, b.v); }
+    friend FloatX4 operator*(FloatX4 a, FloatX4 b) { return _mm_mul_ps(a.v, b.v); }
+    friend FloatX4 operator/(FloatX4 a, FloatX4 b) { return _mm_div_ps(a.v, b.v); }
+    friend FloatX4 min(FloatX4 a, FloatX4 b) { return _mm_min_ps(a.v, b.v); }
+    friend FloatX4 max(FloatX4 a, FloatX4 b) { return _mm_max_ps(a.v, b.v); }
+    friend FloatX4 wrap(FloatX4 a, FloatX4 period)
+    {
+        return _mm_sub_ps(a.v, _mm_and_ps(_mm_cmpge_ps(a.v, period.v), period.v));
+    }
+
+    friend Mask operator<(FloatX4 a, FloatX4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    friend Mask operator<=(FloatX4 a, FloatX4 b) { return _mm_cmple_ps(a.v, b.v); }
+    friend Mask operator>(FloatX4 a, FloatX4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    friend Mask operator==(FloatX4 a, FloatX4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+    friend FloatX4 select(Mask m, FloatX4 a, FloatX4 b)
+    {
+        return _mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v));
+    }
+
+    /// SSE2 has no rounding instruction, truncate and fix up negative values
+    friend FloatX4 floor(FloatX4 a)
+    {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1)));
+    }
+    friend FloatX4 exponent(FloatX4 a)
+    {
+        __m128i e = _mm_srli_epi32(_mm_castps_si128(a.v), 23);
+        return _mm_cvtepi32_ps(_mm_sub_epi32(e, _mm_set1_epi32(127)));
+    }
+    friend FloatX4 mantissa(FloatX4 a)
+    {
+        __m128i m = _mm_and_si128(_mm_castps_si128(a.v), _mm_set1_epi32(0x007fffff));
+        return _mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3f800000)));
+    }
+    friend FloatX4 exp2i(FloatX4 n)
+    {
+        __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+    }
+    friend FloatX4 cbrt(FloatX4 a) { return fast_cbrt(a); }
+
+    static __m128i to_byte(FloatX4 a)
+    {
+        return _mm_cvttps_epi32((max(0.f, min(a, 1.f)) * 255.f + .5f).v);
+    }
+
+    static __m128i pack_rgb(FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        return _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi32(to_byte(r), 16), _mm_slli_epi32(to_byte(g), 8)),
+            _mm_or_si128(to_byte(b), _mm_set1_epi32(int(0xff000000u)))
+        );
+    }
+
+    static void store_rgb(QRgb* out, FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), pack_rgb(r, g, b));
+    }
+
+    static void store_rgb_masked(QRgb* out, FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        __m128 inside = _mm_and_ps(
+            _mm_cmpge_ps(min(r, min(g, b)).v, _mm_set1_ps(-gamut_epsilon)),
+            _mm_cmple_ps(max(r, max(g, b)).v, _mm_set1_ps(1 + gamut_epsilon))
+        );
+        __m128i rgb = _mm_and_si128(pack_rgb(r, g, b), _mm_castps_si128(inside));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), rgb);
+    }
+};
+#endif
+
+#ifdef QTCOLORWIDGETS_NEON
+struct FloatX4
+{
+    static const int width = 4;
+    typedef uint32x4_t Mask;
+    float32x4_t v;
+
+    FloatX4() {}
+    FloatX4(float32x4_t v) : v(v) {}
+    FloatX4(float f) : v(vdupq_n_f32(f)) {}
+
+    static FloatX4 load(const float* p) { return vld1q_f32(p); }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    friend FloatX4 operator+(FloatX4 a, FloatX4 b) { return vaddq_f32(a.v, b.v); }
+    friend FloatX4 operator-(FloatX4 a, FloatX4 b) { return vsubq_f32(a.v, b.v); }
+    friend FloatX4 operator*(FloatX4 a, FloatX4 b) { return vmulq_f32(a.v, b.v); }
+    friend FloatX4 operator/(FloatX4 a, FloatX4 b) { return vdivq_f32(a.v, b.v); }
+    friend FloatX4 min(FloatX4 a, FloatX4 b) { return vminq_f32(a.v, b.v); }
+    friend FloatX4 max(FloatX4 a, FloatX4 b) { return vmaxq_f32(a.v, b.v); }
+    friend FloatX4 wrap(FloatX4 a, FloatX4 period)
+    {
+        uint32x4_t sub = vandq_u32(vcgeq_f32(a.v, period.v), vreinterpretq_u32_f32(period.v));
+        return vsubq_f32(a.v, vreinterpretq_f32_u32(sub));
+    }
+
+    friend Mask operator<(FloatX4 a, FloatX4 b) { return vcltq_f32(a.v, b.v); }
+    friend Mask operator<=(FloatX4 a, FloatX4 b) { return vcleq_f32(a.v, b.v); }
+    friend Mask operator>(FloatX4 a, FloatX4 b) { return vcgtq_f32(a.v, b.v); }
+    friend Mask operator==(FloatX4 a, FloatX4 b) { return vceqq_f32(a.v, b.v); }
+    friend FloatX4 select(Mask m, FloatX4 a, FloatX4 b) { return vbslq_f32(m, a.v, b.v); }
+
+    friend FloatX4 floor(FloatX4 a) { return vrndmq_f32(a.v); }
+    friend FloatX4 exponent(FloatX4 a)
+    {
+        int32x4_t e = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_f32(a.v), 23));
+        return vcvtq_f32_s32(vsubq_s32(e, vdupq_n_s32(127)));
+    }
+    friend FloatX4 mantissa(FloatX4 a)
+    {
+        uint32x4_t m = vandq_u32(vreinterpretq_u32_f32(a.v), vdupq_n_u32(0x007fffff));
+        return vreinterpretq_f32_u32(vorrq_u32(m, vdupq_n_u32(0x3f800000)));
+    }
+    friend FloatX4 exp2i(FloatX4 n)
+    {
+        int32x4_t e = vaddq_s32(vcvtnq_s32_f32(n.v), vdupq_n_s32(127));
+        return vreinterpretq_f32_s32(vshlq_n_s32(e, 23));
+    }
+    friend FloatX4 cbrt(FloatX4 a) { return fast_cbrt(a); }
+
+    static uint32x4_t to_byte(FloatX4 a)
+    {
+        return vcvtq_u32_f32((max(0.f, min(a, 1.f)) * 255.f + .5f).v);
+    }
+
+    static uint32x4_t pack_rgb(FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        return vorrq_u32(
+            vorrq_u32(vshlq_n_u32(to_byte(r), 16), vshlq_n_u32(to_byte(g), 8)),
+            vorrq_u32(to_byte(b), vdupq_n_u32(0xff000000u))
+        );
+    }
+
+    static void store_rgb(QRgb* out, FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        vst1q_u32(reinterpret_cast<uint32_t*>(out), pack_rgb(r, g, b));
+    }
+
+    static void store_rgb_masked(QRgb* out, FloatX4 r, FloatX4 g, FloatX4 b)
+    {
+        uint32x4_t inside = vandq_u32(
+            vcgeq_f32(min(r, min(g, b)).v, vdupq_n_f32(-gamut_epsilon)),
+            vcleq_f32(max(r, max(g, b)).v, vdupq_n_f32(1 + gamut_epsilon))
+        );
+        vst1q_u32(reinterpret_cast<uint32_t*>(out), vandq_u32(pack_rgb(r, g, b), inside));
+    }
+};
+#endif
+
+#ifdef QTCOLORWIDGETS_AVX2
+struct FloatX8
+{
+    static const int width = 8;
+    typedef __m256 Mask;
+    __m256 v;
+
+    FloatX8() {}
+    FloatX8(__m256 v) : v(v) {}
+    FloatX8(float f) : v(_mm256_set1_ps(f)) {}
+
+    static FloatX8 load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend FloatX8 operator+(FloatX8 a, FloatX8 b) { return _mm256_add_ps(a.v, b.v); }
+    friend FloatX8 operator-(FloatX8 a, FloatX8 b) { return _mm256_sub_ps(a.v, b.v); }
+    friend FloatX8 operator*(FloatX8 a, FloatX8 b) { return _mm256_mul_ps(a.v, b.v); }
+    friend FloatX8 operator/(FloatX8 a, FloatX8 b) { return _mm256_div_ps(a.v, b.v); }
+    friend FloatX8 min(FloatX8 a, FloatX8 b) { return _mm256_min_ps(a.v, b.v); }
+    friend FloatX8 max(FloatX8 a, FloatX8 b) { return _mm256_max_ps(a.v, b.v); }
+    friend FloatX8 wrap(FloatX8 a, FloatX8 period)
+    {
+        return _mm256_sub_ps(a.v, _mm256_and_ps(_mm256_cmp_ps(a.v, period.v, _CMP_GE_OQ), period.v));
+    }
+
+    friend Mask operator<(FloatX8 a, FloatX8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend Mask operator<=(FloatX8 a, FloatX8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    friend Mask operator>(FloatX8 a, FloatX8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    friend Mask operator==(FloatX8 a, FloatX8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+    friend FloatX8 select(Mask m, FloatX8 a, FloatX8 b) { return _mm256_blendv_ps(b.v, a.v, m); }
+
+    friend FloatX8 floor(FloatX8 a) { return _mm256_floor_ps(a.v); }
+    friend FloatX8 exponent(FloatX8 a)
+    {
+        __m256i e = _mm256_srli_epi32(_mm256_castps_si256(a.v), 23);
+        return _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(127)));
+    }
+    friend FloatX8 mantissa(FloatX8 a)
+    {
+        __m256i m = _mm256_and_si256(_mm256_castps_si256(a.v), _mm256_set1_epi32(0x007fffff));
+        return _mm256_castsi256_ps(_mm256_or_si256(m, _mm256_set1_epi32(0x3f800000)));
+    }
+    friend FloatX8 exp2i(FloatX8 n)
+    {
+        __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+    }
+    friend FloatX8 cbrt(FloatX8 a) { return fast_cbrt(a); }
+
+    static __m256i to_byte(FloatX8 a)
+    {
+        return _mm256_cvttps_epi32((max(0.f, min(a, 1.f)) * 255.f + .5f).v);
+    }
+
+    static __m256i pack_rgb(FloatX8 r, FloatX8 g, FloatX8 b)
+    {
+        return _mm256_or_si256(
+            _mm256_or_si256(_mm256_slli_epi32(to_byte(r), 16), _mm256_slli_epi32(to_byte(g), 8)),
+            _mm256_or_si256(to_byte(b), _mm256_set1_epi32(int(0xff000000u)))
+        );
+    }
+
+    static void store_rgb(QRgb* out, FloatX8 r, FloatX8 g, FloatX8 b)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), pack_rgb(r, g, b));
+    }
+
+    static void store_rgb_masked(QRgb* out, FloatX8 r, FloatX8 g, FloatX8 b)
+    {
+        __m256 inside = _mm256_and_ps(
+            _mm256_cmp_ps(min(r, min(g, b)).v, _mm256_set1_ps(-gamut_epsilon), _CMP_GE_OQ),
+            _mm256_cmp_ps(max(r, max(g, b)).v, _mm256_set1_ps(1 + gamut_epsilon), _CMP_LE_OQ)
+        );
+        __m256i rgb = _mm256_and_si256(pack_rgb(r, g, b), _mm256_castps_si256(inside));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), rgb);
+    }
+};
+#endif
+
+/// Base 2 logarithm of a positive \p x, accurate to about 1e-7
+template<class Vec>
+inline Vec fast_log2(Vec x)
+{
+    // log2(m) = 2 / ln(2) * atanh((m - 1) / (m + 1)), with m in [sqrt(1/2), sqrt(2))
+    Vec m = mantissa(x);
+    Vec e = exponent(x);
+    typename Vec::Mask high = m > float(sqrt2);
+    m = select(high, m * .5f, m);
+    e = select(high, e + 1.f, e);
+    Vec t = (m - 1.f) / (m + 1.f);
+    Vec t2 = t * t;
+    Vec series = ((t2 * (1.f / 7) + 1.f / 5) * t2 + 1.f / 3) * t2 + 1.f;
+    return e + t * series * float(2 / ln2);
+}
+
+/// 2 to the power of \p x, with \p x clamped to the range of normal floats
+template<class Vec>
+inline Vec fast_exp2(Vec x)
+{
+    x = max(min(x, 127.f), -126.f);
+    Vec n = floor(x + .5f);
+    Vec f = (x - n) * float(ln2);
+    // Taylor series of e^f, |f| <= ln(2) / 2
+    Vec p = f * (1.f / 5040) + 1.f / 720;
+    p = p * f + 1.f / 120;
+    p = p * f + 1.f / 24;
+    p = p * f + 1.f / 6;
+    p = p * f + .5f;
+    p = p * f + 1.f;
+    p = p * f + 1.f;
+    return p * exp2i(n);
+}
+
+/// \p x to the power of \p y, for a positive \p x
+template<class Vec>
+inline Vec fast_pow(Vec x, float y)
+{
+    return fast_exp2(fast_log2(x) * y);
+}
+
+template<class Vec>
+Vec fast_cbrt(Vec x)
+{
+    Vec a = max(x, 0.f - x);
+    // a = m * 2^(3q + r), with m in [1, 2) and r in {0, 1, 2}
+    Vec e = exponent(a);
+    Vec q = floor((e + .5f) * (1.f / 3));
+    Vec r = e - q * 3.f;
+    Vec m = mantissa(a);
+    // Quadratic guess refined by Newton's method
+    Vec y = (m * -.058638f + .433567f) * m + .626352f;
+    y = (y * 2.f + m / (y * y)) * (1.f / 3);
+    y = (y * 2.f + m / (y * y)) * (1.f / 3);
+    Vec scale = select(r == 0.f, Vec(1.f), select(r == 1.f, Vec(1.25992105f), Vec(1.58740105f)));
+    y = select(a < 1e-30f, 0.f, y * scale * exp2i(q));
+    return select(x < 0.f, 0.f - y, y);
+}
+
+/// Vector version of srgb_encode()
+template<class Vec>
+inline Vec encode_srgb(Vec linear)
+{
+    Vec curve = fast_pow(linear, 1.f / 2.4f) * 1.055f - .055f;
+    return select(linear <= .0031308f, linear * 12.92f, curve);
+}
+
+/// Vector version of srgb_decode()
+template<class Vec>
+inline Vec decode_srgb(Vec encoded)
+{
+    Vec curve = fast_pow((encoded + .055f) * (1.f / 1.055f), 2.4f);
+    return select(encoded <= .04045f, encoded * (1.f / 12.92f), curve);
+}
+
+/**
+ * \brief How much a channel is pulled away from its maximum by the hue
+ * \param h6 Hue in [0-6]
+ * \param offset 5 for red, 3 for green, 1 for blue
+ * \returns 0 where the channel is at full intensity, 1 where it's at its minimum
+ */
+template<class Vec>
+inline Vec hue_falloff(Vec h6, float offset)
+{
+    Vec k = wrap(h6 + offset, 6.f);
+    return max(0.f, min(min(k, 4.f - k), 1.f));
+}
+
+/// Hue in [0-1] of an RGB color, 0 for grays
+template<class Vec>
+inline Vec rgb_hue(Vec r, Vec g, Vec b, Vec max_channel, Vec chroma)
+{
+    Vec inverse = Vec(1.f) / max(chroma, 1e-30f);
+    Vec h = select(max_channel == r, (g - b) * inverse,
+            select(max_channel == g, (b - r) * inverse + 2.f, (r - g) * inverse + 4.f));
+    h = h * (1.f / 6);
+    return select(h < 0.f, h + 1.f, h);
+}
+
+/*
+ * Color space policies, components are in the order of BatchColorSpace.
+ */
+
+struct HsvLine
+{
+    template<class Vec>
+    static void to_rgb(Vec hue, Vec sat, Vec val, Vec& r, Vec& g, Vec& b)
+    {
+        Vec h6 = hue * 6.f;
+        Vec vs = val * sat;
+        r = val - vs * hue_falloff(h6, 5);
+        g = val - vs * hue_falloff(h6, 3);
+        b = val - vs * hue_falloff(h6, 1);
+    }
+
+    template<class Vec>
+    static void from_rgb(Vec r, Vec g, Vec b, Vec& hue, Vec& sat, Vec& val)
+    {
+        val = max(r, max(g, b));
+        Vec chroma = val - min(r, min(g, b));
+        hue = rgb_hue(r, g, b, val, chroma);
+        sat = chroma / max(val, 1e-30f);
+    }
+};
+
+struct HslLine
+{
+    template<class Vec>
+    static void to_rgb(Vec hue, Vec sat, Vec lig, Vec& r, Vec& g, Vec& b)
+    {
+        Vec h6 = hue * 6.f;
+        Vec l2 = lig * 2.f - 1.f;
+        Vec chroma = (1.f - max(l2, 0.f - l2)) * sat;
+        Vec top = lig + chroma * .5f;
+        r = top - chroma * hue_falloff(h6, 5);
+        g = top - chroma * hue_falloff(h6, 3);
+        b = top - chroma * hue_falloff(h6, 1);
+    }
+
+    template<class Vec>
+    static void from_rgb(Vec r, Vec g, Vec b, Vec& hue, Vec& sat, Vec& lig)
+    {
+        Vec top = max(r, max(g, b));
+        Vec bottom = min(r, min(g, b));
+        Vec chroma = top - bottom;
+        hue = rgb_hue(r, g, b, top, chroma);
+        lig = (top + bottom) * .5f;
+        Vec l2 = lig * 2.f - 1.f;
+        sat = chroma / max(1.f - max(l2, 0.f - l2), 1e-30f);
+    }
+};
+
+struct LchLine
+{
+    template<class Vec>
+    static void to_rgb(Vec hue, Vec chroma, Vec luma, Vec& r, Vec& g, Vec& b)
+    {
+        Vec h6 = hue * 6.f;
+        Vec fr = hue_falloff(h6, 5);
+        Vec fg = hue_falloff(h6, 3);
+        Vec fb = hue_falloff(h6, 1);
+        // Same weights as color_lumaF()
+        Vec falloff_luma = fr * .30f + fg * .59f + fb * .11f;
+        r = luma + chroma * (falloff_luma - fr);
+        g = luma + chroma * (falloff_luma - fg);
+        b = luma + chroma * (falloff_luma - fb);
+    }
+
+    template<class Vec>
+    static void from_rgb(Vec r, Vec g, Vec b, Vec& hue, Vec& chroma, Vec& luma)
+    {
+        Vec top = max(r, max(g, b));
+        chroma = top - min(r, min(g, b));
+        hue = rgb_hue(r, g, b, top, chroma);
+        luma = r * .30f + g * .59f + b * .11f;
+    }
+};
+
+/// CIE L*a*b* relative to D65, the white point of sRGB
+struct LabLine
+{
+    template<class Vec>
+    static Vec f(Vec t)
+    {
+        const float delta = 6.f / 29;
+        return select(t > delta * delta * delta, cbrt(t), t * (1 / (3 * delta * delta)) + 4.f / 29);
+    }
+
+    template<class Vec>
+    static Vec f_inverse(Vec t)
+    {
+        const float delta = 6.f / 29;
+        return select(t > delta, t * t * t, (t - 4.f / 29) * (3 * delta * delta));
+    }
+
+    template<class Vec>
+    static void to_rgb(Vec lightness, Vec a, Vec b, Vec& red, Vec& green, Vec& blue)
+    {
+        Vec fy = (lightness + 16.f) * (1.f / 116);
+        Vec x = f_inverse(fy + a * (1.f / 500)) * .95047f;
+        Vec y = f_inverse(fy);
+        Vec z = f_inverse(fy - b * (1.f / 200)) * 1.08883f;
+        red   = encode_srgb(x *  3.2404542f - y * 1.5371385f - z * .4985314f);
+        green = encode_srgb(x * -.9692660f  + y * 1.8760108f + z * .0415560f);
+        blue  = encode_srgb(x *  .0556434f  - y * .2040259f  + z * 1.0572252f);
+    }
+
+    template<class Vec>
+    static void from_rgb(Vec red, Vec green, Vec blue, Vec& lightness, Vec& a, Vec& b)
+    {
+        red = decode_srgb(red);
+        green = decode_srgb(green);
+        blue = decode_srgb(blue);
+        Vec fx = f((red * .4124564f + green * .3575761f + blue * .1804375f) * (1 / .95047f));
+        Vec fy = f(red * .2126729f + green * .7151522f + blue * .0721750f);
+        Vec fz = f((red * .0193339f + green * .1191920f + blue * .9503041f) * (1 / 1.08883f));
+        lightness = fy * 116.f - 16.f;
+        a = (fx - fy) * 500.f;
+        b = (fy - fz) * 200.f;
+    }
+};
+
+struct OklabLine
+{
+    template<class Vec>
+    static void to_rgb(Vec lightness, Vec a, Vec b, Vec& red, Vec& green, Vec& blue)
+    {
+        oklab_to_linear_srgb(lightness, a, b, red, green, blue);
+        red = encode_srgb(red);
+        green = encode_srgb(green);
+        blue = encode_srgb(blue);
+    }
+
+    template<class Vec>
+    static void from_rgb(Vec red, Vec green, Vec blue, Vec& lightness, Vec& a, Vec& b)
+    {
+        linear_srgb_to_oklab(decode_srgb(red), decode_srgb(green), decode_srgb(blue), lightness, a, b);
+    }
+};
+
+struct ToRgb
+{
+    template<class Space, class Vec>
+    static void convert(Vec c0, Vec c1, Vec c2, Vec& r, Vec& g, Vec& b)
+    {
+        Space::to_rgb(c0, c1, c2, r, g, b);
+    }
+};
+
+struct FromRgb
+{
+    template<class Space, class Vec>
+    static void convert(Vec r, Vec g, Vec b, Vec& c0, Vec& c1, Vec& c2)
+    {
+        Space::from_rgb(r, g, b, c0, c1, c2);
+    }
+};
+
+/**
+ * \brief Converts as many pixels as possible in chunks of Vec::width
+ * \returns Index of the first pixel that hasn't been converted
+ */
+template<class Space, class Vec, bool Mask>
+inline int convert_span(const float* h, const float* s, const float* v, QRgb* out, int start, int count)
+{
+    int i = start;
+    for ( ; i + Vec::width <= count; i += Vec::width )
+    {
+        Vec r, g, b;
+        Space::to_rgb(Vec::load(h+i), Vec::load(s+i), Vec::load(v+i), r, g, b);
+        if ( Mask )
+            Vec::store_rgb_masked(out+i, r, g, b);
+        else
+            Vec::store_rgb(out+i, r, g, b);
+    }
+    return i;
+}
+
+template<class Space, bool Mask>
+void convert_line(const float* h, const float* s, const float* v, QRgb* out, int count)
+{
+    int i = 0;
+#ifdef QTCOLORWIDGETS_AVX2
+    i = convert_span<Space, FloatX8, Mask>(h, s, v, out, i, count);
+#endif
+#if defined(QTCOLORWIDGETS_SSE2) || defined(QTCOLORWIDGETS_NEON)
+    i = convert_span<Space, FloatX4, Mask>(h, s, v, out, i, count);
+#endif
+    convert_span<Space, FloatX1, Mask>(h, s, v, out, i, count);
+}
+
+/**
+ * \brief Converts planar components in place in chunks of Vec::width
+ * \returns Index of the first pixel that hasn't been converted
+ */
+template<class Space, class Direction, class Vec>
+inline int convert_planar_span(float* c0, float* c1, float* c2, int start, int count)
+{
+    int i = start;
+    for ( ; i + Vec::width <= count; i += Vec::width )
+    {
+        Vec x, y, z;
+        Direction::template convert<Space>(Vec::load(c0+i), Vec::load(c1+i), Vec::load(c2+i), x, y, z);
+        x.store(c0+i);
+        y.store(c1+i);
+        z.store(c2+i);
+    }
+    return i;
+}
+
+template<class Space, class Direction>
+void convert_planar(float* c0, float* c1, float* c2, int count)
+{
+    int i = 0;
+#ifdef QTCOLORWIDGETS_AVX2
+    i = convert_planar_span<Space, Direction, FloatX8>(c0, c1, c2, i, count);
+#endif
+#if defined(QTCOLORWIDGETS_SSE2) || defined(QTCOLORWIDGETS_NEON)
+    i = convert_planar_span<Space, Direction, FloatX4>(c0, c1, c2, i, count);
+#endif
+    convert_planar_span<Space, Direction, FloatX1>(c0, c1, c2, i, count);
+}
+
+/**
+ * \brief Converts pixels sharing the same hue falloffs in chunks of Vec::width
+ * \returns Index of the first pixel that hasn't been converted
+ */
+template<class Vec>
+inline int convert_span_hue(const float* falloff, const float* top, const float* chroma,
+                            QRgb* out, int start, int count)
+{
+    int i = start;
+    for ( ; i + Vec::width <= count; i += Vec::width )
+    {
+        Vec t = Vec::load(top+i);
+        Vec c = Vec::load(chroma+i);
+        Vec::store_rgb(out+i, t - c * falloff[0], t - c * falloff[1], t - c * falloff[2]);
+    }
+    return i;
+}
+
+inline void convert_hue_line(const float* falloff, const float* top, const float* chroma, QRgb* out, int count)
+{
+    int i = 0;
+#ifdef QTCOLORWIDGETS_AVX2
+    i = convert_span_hue<FloatX8>(falloff, top, chroma, out, i, count);
+#endif
+#if defined(QTCOLORWIDGETS_SSE2) || defined(QTCOLORWIDGETS_NEON)
+    i = convert_span_hue<FloatX4>(falloff, top, chroma, out, i, count);
+#endif
+    convert_span_hue<FloatX1>(falloff, top, chroma, out, i, count);
+}
+
+template<class Space>
+inline void set_batch_kernels(BatchKernels& kernels, int index)
+{
+    kernels.to_rgb[index] = &convert_planar<Space, ToRgb>;
+    kernels.from_rgb[index] = &convert_planar<Space, FromRgb>;
+    kernels.to_packed[index] = &convert_line<Space, false>;
+    kernels.to_packed_masked[index] = &convert_line<Space, true>;
+}
+
+/// Instantiates every kernel for the instruction sets enabled in this translation unit
+inline BatchKernels make_batch_kernels(const char* name)
+{
+    BatchKernels kernels;
+    kernels.name = name;
+    set_batch_kernels<HsvLine>(kernels, batch_hsv);
+    set_batch_kernels<HslLine>(kernels, batch_hsl);
+    set_batch_kernels<LchLine>(kernels, batch_lch);
+    set_batch_kernels<LabLine>(kernels, batch_cielab);
+    set_batch_kernels<OklabLine>(kernels, batch_oklab);
+    kernels.hue_line = &convert_hue_line;
+    return kernels;
+}
+
+} // namespace
+} // namespace utils
+} // namespace color_widgets
+
+#endif // COLOR_WIDGETS_COLOR_UTILS_BATCH_KERNELS_HPP
@@ -88,28 +88,49 @@ unsigned int ColorWheel::wheelWidth() const
 void ColorWheel::setWheelWidth(unsigned int w)
 {
     p->wheel_width = w;
+    p->render_ring();
     p->render_inner_selector();
     update();
     Q_EMIT wheelWidthChanged(w);
 }
 
+bool ColorWheel::event(QEvent* event)
+{
+    if ( event->type() == QEvent::MouseMove && p->coalesce_move(static_cast<QMouseEvent*>(event)) )
+    {
+        event->accept();
+        return true;
+    }
+
+    if ( event->type() == SelectorRenderedEvent::event_type() )
+    {
+        p->selector_rendered(static_cast<SelectorRenderedEvent*>(event));
+        return true;
+    }
+
+    return QWidget::event(event);
+}
+
 void ColorWheel::paintEvent(QPaintEvent * )
 {
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
     painter.translate(geometry().width()/2,geometry().height()/2);
 
-    // hue wheel
-    if(p->hue_ring.isNull())
+    // hue wheel, re-rendered when moved to a screen with a different pixel ratio
+    if(p->hue_ring.isNull() || p->hue_ring.devicePixelRatio() != devicePixelRatioF())
         p->render_ring();
 
-    painter.drawPixmap(-p->outer_radius(), -p->outer_radius(), p->hue_ring);
+    // The ring is scaled while resizing
+    qreal outer = p->outer_radius();
+    painter.drawPixmap(QRectF(-outer, -outer, outer*2, outer*2), p->hue_ring, QRectF(p->hue_ring.rect()));
 
     // hue selector
     p->draw_ring_editor(p->hue, painter, Qt::black);
 
     // lum-sat square
-    if(p->inner_selector.isNull())
+    if(p->inner_selector.isNull() ||
+        (!p->resizing() && p->inner_selector.size() != p->selector_image_size().toSize()))
         p->render_inner_selector();
 
     painter.rotate(p->selector_image_angle());
@@ -160,49 +181,15 @@ void ColorWheel::paintEvent(QPaintEvent * )
 
 void ColorWheel::mouseMoveEvent(QMouseEvent *ev)
 {
-    if (p->mouse_status == DragCircle )
-    {
-        auto hue = p->line_to_point(ev->pos()).angle()/360.0;
-        p->hue = hue;
-        p->render_inner_selector();
-
-        Q_EMIT colorSelected(color());
-        Q_EMIT colorChanged(color());
-        update();
-    }
-    else if(p->mouse_status == DragSquare)
-    {
-        QLineF glob_mouse_ln = p->line_to_point(ev->pos());
-        QLineF center_mouse_ln ( QPointF(0,0),
-                                 glob_mouse_ln.p2() - glob_mouse_ln.p1() );
-
-        center_mouse_ln.setAngle(center_mouse_ln.angle()+p->selector_image_angle());
-        center_mouse_ln.setP2(center_mouse_ln.p2()-p->selector_image_offset());
-
-        if ( p->selector_shape == ShapeSquare )
-        {
-            p->sat = qBound(0.0, center_mouse_ln.x2()/p->square_size(), 1.0);
-            p->val = qBound(0.0, center_mouse_ln.y2()/p->square_size(), 1.0);
-        }
-        else if ( p->selector_shape == ShapeTriangle )
-        {
-            QPointF pt = center_mouse_ln.p2();
-
-            qreal side = p->triangle_side();
-            p->val = qBound(0.0, pt.x() / p->triangle_height(), 1.0);
-            qreal slice_h = side * p->val;
+    if ( !p->pick_color(ev->pos()) )
+        return;
 
-            qreal ycenter = side/2;
-            qreal ymin = ycenter-slice_h/2;
-
-            if ( slice_h > 0 )
-                p->sat = qBound(0.0, (pt.y()-ymin)/slice_h, 1.0);
-        }
+    if ( p->mouse_status == DragCircle )
+        p->render_preview();
 
-        Q_EMIT colorSelected(color());
-        Q_EMIT colorChanged(color());
-        update();
-    }
+    Q_EMIT colorSelected(color());
+    Q_EMIT colorChanged(color());
+    update();
 }
 
 void ColorWheel::mousePressEvent(QMouseEvent *ev)
@@ -223,14 +210,26 @@ void ColorWheel::mousePressEvent(QMouseEvent *ev)
 
 void ColorWheel::mouseReleaseEvent(QMouseEvent *ev)
 {
+    // The release position supersedes any deferred move
+    p->cancel_input();
+    p->releasing = true;
     mouseMoveEvent(ev);
+    p->releasing = false;
     p->mouse_status = Nothing;
+    p->finish_preview();
     if ( ev->button() == Qt::LeftButton )
         Q_EMIT editingFinished();
 }
 
 void ColorWheel::resizeEvent(QResizeEvent *)
 {
+    // Keep showing the old images until the size settles
+    if ( p->resize_debounce > 0 && !p->hue_ring.isNull() )
+    {
+        p->resize_timer.start(p->resize_debounce);
+        return;
+    }
+
     p->render_ring();
     p->render_inner_selector();
 }
@@ -294,25 +293,28 @@ void ColorWheel::setColorSpace(color_widgets::ColorWheel::ColorSpaceEnum space)
                 p->hue = old_col.hueF();
                 p->sat = utils::color_HSL_saturationF(old_col);
                 p->val = utils::color_lightnessF(old_col);
-                p->color_from = &utils::color_from_hsl;
-                p->rainbow_from_hue = &utils::rainbow_hsv;
                 break;
             case ColorHSV:
                 p->hue = old_col.hsvHueF();
                 p->sat = old_col.hsvSaturationF();
                 p->val = old_col.valueF();
-                p->color_from = &QColor::fromHsvF;
-                p->rainbow_from_hue = &utils::rainbow_hsv;
                 break;
             case ColorLCH:
                 p->hue = old_col.hueF();
                 p->sat = utils::color_chromaF(old_col);
                 p->val = utils::color_lumaF(old_col);
-                p->color_from = &utils::color_from_lch;
-                p->rainbow_from_hue = &utils::rainbow_lch;
                 break;
+            case ColorOKLCH:
+            {
+                qreal hue;
+                utils::color_to_oklch(old_col, hue, p->sat, p->val);
+                if ( hue >= 0 )
+                    p->hue = hue;
+                break;
+            }
         }
 
+        p->update_renderer();
         p->render_ring();
         p->render_inner_selector();
         update();
@@ -332,12 +334,157 @@ void ColorWheel::setSelectorShape(color_widgets::ColorWheel::ShapeEnum shape)
     if ( shape != p->selector_shape )
     {
         p->selector_shape = shape;
+        p->update_renderer();
         update();
         p->render_inner_selector();
         Q_EMIT selectorShapeChanged(shape);
     }
 }
 
+int ColorWheel::renderThreads() const
+{
+    return p->render_threads;
+}
+
+void ColorWheel::setRenderThreads(int threads)
+{
+    threads = qMax(threads, 0);
+    if ( threads != p->render_threads )
+    {
+        p->render_threads = threads;
+        Q_EMIT renderThreadsChanged(threads);
+    }
+}
+
+int ColorWheel::selectorCacheSize() const
+{
+    return p->selector_cache.maxCost();
+}
+
+void ColorWheel::setSelectorCacheSize(int bytes)
+{
+    bytes = qMax(bytes, 0);
+    if ( bytes != p->selector_cache.maxCost() )
+    {
+        p->selector_cache.setMaxCost(bytes);
+        Q_EMIT selectorCacheSizeChanged(bytes);
+    }
+}
+
+int ColorWheel::selectorCacheHueSteps() const
+{
+    return p->selector_cache_hue_steps;
+}
+
+void ColorWheel::setSelectorCacheHueSteps(int steps)
+{
+    steps = qMax(steps, 0);
+    if ( steps != p->selector_cache_hue_steps )
+    {
+        p->selector_cache_hue_steps = steps;
+        p->render_inner_selector();
+        update();
+        Q_EMIT selectorCacheHueStepsChanged(steps);
+    }
+}
+
+qint64 ColorWheel::selectorCacheHits() const
+{
+    return p->selector_cache_hits;
+}
+
+qint64 ColorWheel::selectorCacheMisses() const
+{
+    return p->selector_cache_misses;
+}
+
+int ColorWheel::progressiveDownscale() const
+{
+    return p->progressive_downscale;
+}
+
+void ColorWheel::setProgressiveDownscale(int factor)
+{
+    factor = qMax(factor, 1);
+    if ( factor != p->progressive_downscale )
+    {
+        p->progressive_downscale = factor;
+        p->finish_preview();
+        Q_EMIT progressiveDownscaleChanged(factor);
+    }
+}
+
+int ColorWheel::selectorPixelBudget() const
+{
+    return p->selector_pixel_budget;
+}
+
+void ColorWheel::setSelectorPixelBudget(int pixels)
+{
+    pixels = qMax(pixels, 0);
+    if ( pixels != p->selector_pixel_budget )
+    {
+        p->selector_pixel_budget = pixels;
+        p->render_inner_selector();
+        update();
+        Q_EMIT selectorPixelBudgetChanged(pixels);
+    }
+}
+
+bool ColorWheel::coalesceInput() const
+{
+    return p->coalesce_input;
+}
+
+void ColorWheel::setCoalesceInput(bool coalesce)
+{
+    if ( coalesce != p->coalesce_input )
+    {
+        p->coalesce_input = coalesce;
+        if ( !coalesce )
+        {
+            p->input_timer.stop();
+            p->flush_input();
+        }
+        Q_EMIT coalesceInputChanged(coalesce);
+    }
+}
+
+bool ColorWheel::asyncRender() const
+{
+    return p->async_render;
+}
+
+void ColorWheel::setAsyncRender(bool async)
+{
+    if ( async != p->async_render )
+    {
+        // The render state is shared, so the background render must be done
+        p->wait_async_render();
+        p->async_render = async;
+        p->render_inner_selector();
+        update();
+        Q_EMIT asyncRenderChanged(async);
+    }
+}
+
+int ColorWheel::resizeDebounce() const
+{
+    return p->resize_debounce;
+}
+
+void ColorWheel::setResizeDebounce(int msecs)
+{
+    msecs = qMax(msecs, 0);
+    if ( msecs != p->resize_debounce )
+    {
+        p->resize_debounce = msecs;
+        if ( p->resizing() )
+            p->finish_resize();
+        Q_EMIT resizeDebounceChanged(msecs);
+    }
+}
+
 void ColorWheel::dragEnterEvent(QDragEnterEvent* event)
 {
     if ( event->mimeData()->hasColor() ||
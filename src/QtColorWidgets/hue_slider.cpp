@@ -22,6 +22,7 @@
  *
  */
 #include "QtColorWidgets/hue_slider.hpp"
+#include "QtColorWidgets/color_space_private.hpp"
 
 namespace color_widgets {
 
@@ -34,6 +35,10 @@ public:
     qreal saturation = 1;
     qreal value = 1;
     qreal alpha = 1;
+    ColorWheel::ColorSpaceEnum color_space = ColorWheel::ColorHSV;
+    QColor (*color_from)(qreal,qreal,qreal,qreal) = &HsvSpace::color;
+    void (*components_from)(const QColor&, qreal&, qreal&, qreal&) = &HsvSpace::components;
+    int hue_stops = HsvSpace::hue_stops;
 
     Private(HueSlider *widget)
         : w(widget)
@@ -48,13 +53,41 @@ public:
 
     void updateGradient()
     {
-        static const double n_colors = 6;
+        const double n_colors = hue_stops;
         QGradientStops colors;
-        colors.reserve(n_colors+1);
-        for ( int i = 0; i <= n_colors; ++i )
-            colors.append(QGradientStop(i/n_colors, QColor::fromHsvF(i/n_colors, saturation, value)));
+        colors.reserve(hue_stops+1);
+        for ( int i = 0; i <= hue_stops; ++i )
+            colors.append(QGradientStop(i/n_colors, color_from(i/n_colors, saturation, value, 1)));
         w->setColors(colors);
     }
+
+    template<class Space>
+    void setColorSpace()
+    {
+        color_from = &Space::color;
+        components_from = &Space::components;
+        hue_stops = Space::hue_stops;
+    }
+
+    /// Picks the color functions for color_space
+    void updateColorSpace()
+    {
+        switch ( color_space )
+        {
+            case ColorWheel::ColorHSV:
+                setColorSpace<HsvSpace>();
+                break;
+            case ColorWheel::ColorHSL:
+                setColorSpace<HslSpace>();
+                break;
+            case ColorWheel::ColorLCH:
+                setColorSpace<LchSpace>();
+                break;
+            case ColorWheel::ColorOKLCH:
+                setColorSpace<OklchSpace>();
+                break;
+        }
+    }
 };
 
 HueSlider::HueSlider(QWidget *parent) :
@@ -110,15 +143,16 @@ void HueSlider::setColorAlpha(qreal alpha)
 
 QColor HueSlider::color() const
 {
-    return QColor::fromHsvF(colorHue(), p->saturation, p->value, p->alpha);
+    return p->color_from(colorHue(), p->saturation, p->value, p->alpha);
 }
 
 void HueSlider::setColor(const QColor& color)
 {
-    p->saturation = color.saturationF();
-    p->value = color.valueF();
+    qreal hue;
+    p->components_from(color, hue, p->saturation, p->value);
     p->updateGradient();
-    setColorHue(color.hueF());
+    // Grays have no hue, keep the current one
+    setColorHue(hue >= 0 ? hue : colorHue());
     Q_EMIT colorValueChanged(p->alpha);
     Q_EMIT colorSaturationChanged(p->alpha);
 }
@@ -130,6 +164,23 @@ void HueSlider::setFullColor(const QColor& color)
     Q_EMIT colorAlphaChanged(p->alpha);
 }
 
+ColorWheel::ColorSpaceEnum HueSlider::colorSpace() const
+{
+    return p->color_space;
+}
+
+void HueSlider::setColorSpace(ColorWheel::ColorSpaceEnum space)
+{
+    if ( space != p->color_space )
+    {
+        QColor old_color = color();
+        p->color_space = space;
+        p->updateColorSpace();
+        setColor(old_color);
+        Q_EMIT colorSpaceChanged(space);
+    }
+}
+
 qreal HueSlider::colorHue() const
 {
     if (maximum() == minimum())
@@ -0,0 +1,232 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <vector>
+
+#include "QtColorWidgets/color_utils.hpp"
+
+using namespace color_widgets;
+
+/**
+ * \brief Compares the batch conversions with converting one QColor at a time
+ *
+ * The selector benchmarks render a size x size square the way ColorWheel
+ * renders its inner selector on every frame while the hue is dragged.
+ */
+class BenchBatchConversion : public QObject
+{
+    Q_OBJECT
+
+private:
+    static void selector_data()
+    {
+        QTest::addColumn<int>("space");
+        QTest::addColumn<int>("size");
+
+        const char* names[] = {"hsv", "hsl", "lch"};
+        for ( int space = 0; space < 3; space++ )
+            for ( int size : {128, 256, 512} )
+                QTest::newRow(qPrintable(QStringLiteral("%1 %2").arg(QString::fromLatin1(names[space])).arg(size)))
+                    << space << size;
+    }
+
+    static void convert_data()
+    {
+        QTest::addColumn<int>("space");
+        QTest::newRow("hsv") << int(utils::BatchColorSpace::HSV);
+        QTest::newRow("hsl") << int(utils::BatchColorSpace::HSL);
+        QTest::newRow("lch") << int(utils::BatchColorSpace::LCH);
+        QTest::newRow("cielab") << int(utils::BatchColorSpace::CIELab);
+        QTest::newRow("oklab") << int(utils::BatchColorSpace::OKLab);
+    }
+
+    /// Same as the old per pixel ColorWheel renderer
+    static QRgb pixel(int space, qreal hue, qreal sat, qreal val)
+    {
+        if ( space == 1 )
+            return utils::color_from_hsl(hue, sat, val).rgb();
+        if ( space == 2 )
+            return utils::color_from_lch(hue, sat, val).rgb();
+        return QColor::fromHsvF(hue, sat, val).rgb();
+    }
+
+    static void line(int space, const float* hue, const float* sat, const float* val, QRgb* out, int count)
+    {
+        if ( space == 1 )
+            utils::rgb_line_from_hsl(hue, sat, val, out, count);
+        else if ( space == 2 )
+            utils::rgb_line_from_lch(hue, sat, val, out, count);
+        else
+            utils::rgb_line_from_hsv(hue, sat, val, out, count);
+    }
+
+    /// 512x512 opaque colors covering the RGB cube
+    static std::vector<QRgb> packed_colors()
+    {
+        std::vector<QRgb> colors(512 * 512);
+        for ( std::size_t i = 0; i < colors.size(); i++ )
+            colors[i] = qRgb(int(i & 0xff), int((i >> 8) & 0xff), int((i * 37) & 0xff));
+        return colors;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        qDebug("Batch kernels: %s", utils::batch_instruction_set());
+    }
+
+    void benchmark_selector_qcolor_data()
+    {
+        selector_data();
+    }
+
+    void benchmark_selector_qcolor()
+    {
+        QFETCH(int, space);
+        QFETCH(int, size);
+        std::vector<QRgb> out(std::size_t(size) * size);
+
+        QBENCHMARK
+        {
+            for ( int y = 0; y < size; ++y )
+                for ( int x = 0; x < size; ++x )
+                    out[std::size_t(y) * size + x] = pixel(space, 0.3, double(x) / size, 1 - double(y) / size);
+        }
+    }
+
+    void benchmark_selector_batch_data()
+    {
+        selector_data();
+    }
+
+    void benchmark_selector_batch()
+    {
+        QFETCH(int, space);
+        QFETCH(int, size);
+        std::vector<QRgb> out(std::size_t(size) * size);
+        std::vector<float> hue(size, 0.3f);
+        std::vector<float> sat(size);
+        std::vector<float> val(size);
+        for ( int x = 0; x < size; ++x )
+            sat[x] = float(x) / size;
+
+        QBENCHMARK
+        {
+            for ( int y = 0; y < size; ++y )
+            {
+                std::fill(val.begin(), val.end(), 1 - float(y) / size);
+                line(space, hue.data(), sat.data(), val.data(), out.data() + std::size_t(y) * size, size);
+            }
+        }
+    }
+
+    void benchmark_convert_from_rgb_data()
+    {
+        convert_data();
+    }
+
+    void benchmark_convert_from_rgb()
+    {
+        QFETCH(int, space);
+        std::vector<QRgb> colors = packed_colors();
+        std::vector<float> out(colors.size() * 3);
+
+        QBENCHMARK
+        {
+            utils::convert_from_rgb(utils::BatchColorSpace(space), colors.data(), out.data(), int(colors.size()));
+        }
+    }
+
+    void benchmark_convert_to_rgb_data()
+    {
+        convert_data();
+    }
+
+    void benchmark_convert_to_rgb()
+    {
+        QFETCH(int, space);
+        std::vector<QRgb> colors = packed_colors();
+        std::vector<float> components(colors.size() * 3);
+        utils::convert_from_rgb(utils::BatchColorSpace(space), colors.data(), components.data(), int(colors.size()));
+
+        QBENCHMARK
+        {
+            utils::convert_to_rgb(utils::BatchColorSpace(space), components.data(), colors.data(), int(colors.size()));
+        }
+    }
+
+    void benchmark_round_trip_integer_data()
+    {
+        QTest::addColumn<int>("space");
+        QTest::newRow("hsv") << int(utils::BatchColorSpace::HSV);
+        QTest::newRow("hsl") << int(utils::BatchColorSpace::HSL);
+    }
+
+    /// 8-bit colors to quint16 components and back
+    void benchmark_round_trip_integer()
+    {
+        QFETCH(int, space);
+        std::vector<QRgb> colors = packed_colors();
+        std::vector<quint16> components(colors.size() * 3);
+        int count = int(colors.size());
+
+        QBENCHMARK
+        {
+            utils::convert_from_rgb(utils::BatchColorSpace(space), colors.data(), components.data(), count);
+            utils::convert_to_rgb(utils::BatchColorSpace(space), components.data(), colors.data(), count);
+        }
+    }
+
+    void benchmark_round_trip_qcolor_data()
+    {
+        benchmark_round_trip_integer_data();
+    }
+
+    /// Same as benchmark_round_trip_integer() with the qreal QColor conversions
+    void benchmark_round_trip_qcolor()
+    {
+        QFETCH(int, space);
+        std::vector<QRgb> colors = packed_colors();
+        std::vector<qreal> components(colors.size() * 3);
+        bool hsl = space == int(utils::BatchColorSpace::HSL);
+
+        QBENCHMARK
+        {
+            for ( std::size_t i = 0; i < colors.size(); i++ )
+            {
+                qreal* c = components.data() + 3 * i;
+                if ( hsl )
+                    QColor(colors[i]).getHslF(c, c + 1, c + 2);
+                else
+                    QColor(colors[i]).getHsvF(c, c + 1, c + 2);
+            }
+            for ( std::size_t i = 0; i < colors.size(); i++ )
+            {
+                const qreal* c = components.data() + 3 * i;
+                colors[i] = (hsl ? QColor::fromHslF(c[0], c[1], c[2]) : QColor::fromHsvF(c[0], c[1], c[2])).rgb();
+            }
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchBatchConversion)
+#include "bench_batch_conversion.moc"
@@ -0,0 +1,208 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "QtColorWidgets/color_palette.hpp"
+#include "QtColorWidgets/gpl_parser_private.hpp"
+
+using namespace color_widgets;
+
+/**
+ * \brief Compares GplParser with the QTextStream loader it replaced
+ *
+ * Palettes are generated with 10k, 100k and 1M colors, with comments and
+ * names on every color.
+ */
+class BenchGplParser : public QObject
+{
+    Q_OBJECT
+
+private:
+    typedef QVector<QPair<QColor, QString>> Colors;
+
+    static QByteArray palette(int count)
+    {
+        QByteArray data = "GIMP Palette\nName: Benchmark\nColumns: 16\n# Generated\n#\n";
+        data.reserve(data.size() + count * 24);
+        for ( int i = 0; i < count; i++ )
+        {
+            if ( i % 100 == 0 )
+                data += "# Group " + QByteArray::number(i / 100) + "\n";
+            data += QByteArray::number(i & 0xff) + ' ' + QByteArray::number((i >> 8) & 0xff) + ' ' +
+                    QByteArray::number((i * 37) & 0xff) + "\tColor " + QByteArray::number(i) + '\n';
+        }
+        return data;
+    }
+
+    static void palette_data()
+    {
+        QTest::addColumn<QByteArray>("data");
+        QTest::addColumn<int>("count");
+        for ( int count : {10000, 100000, 1000000} )
+            QTest::newRow(qPrintable(QString::number(count))) << palette(count) << count;
+    }
+
+    /// The loop of ColorPalette::load() before GplParser
+    static Colors text_stream_load(QIODevice* device)
+    {
+        Colors colors;
+        QTextStream stream(device);
+
+        if ( stream.readLine() != QLatin1String("GIMP Palette") )
+            return colors;
+
+        QString line;
+        QHash<QString, QString> properties;
+        while ( !stream.atEnd() )
+        {
+            line = stream.readLine();
+            if ( line.isEmpty() )
+                continue;
+            if ( line[0] == '#' )
+                break;
+            int colon = line.indexOf(':');
+            if ( colon == -1 )
+                break;
+            properties[line.left(colon).toLower()] = line.right(line.size() - colon - 1).trimmed();
+        }
+
+        if ( !stream.atEnd() && line[0] == '#' )
+            while ( !stream.atEnd() )
+            {
+                qint64 pos = stream.pos();
+                line = stream.readLine();
+                if ( !line.isEmpty() && line[0] != '#' )
+                {
+                    stream.seek(pos);
+                    break;
+                }
+            }
+
+        while ( !stream.atEnd() )
+        {
+            int r = 0, g = 0, b = 0;
+            stream >> r >> g >> b;
+            line = stream.readLine().trimmed();
+            colors.push_back(qMakePair(QColor(r, g, b), line));
+        }
+        return colors;
+    }
+
+private Q_SLOTS:
+    void benchmark_text_stream_data()
+    {
+        palette_data();
+    }
+
+    void benchmark_text_stream()
+    {
+        QFETCH(QByteArray, data);
+
+        QBENCHMARK
+        {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::ReadOnly | QIODevice::Text);
+            text_stream_load(&buffer);
+        }
+    }
+
+    void benchmark_parser_data()
+    {
+        palette_data();
+    }
+
+    /// Same work as ColorPalette::load() does with the parser, building the colors and names
+    void benchmark_parser()
+    {
+        QFETCH(QByteArray, data);
+        QFETCH(int, count);
+
+        QBENCHMARK
+        {
+            GplParser parser(data.constData(), data.size());
+            QVERIFY(parser.readHeader());
+
+            Colors colors;
+            colors.reserve(parser.estimateColors());
+            QRgb rgb;
+            const char* name;
+            int name_size;
+            while ( parser.readColor(rgb, name, name_size) )
+                colors.push_back(qMakePair(QColor(rgb), QString::fromUtf8(name, name_size)));
+
+            QVERIFY(!parser.failed());
+            QCOMPARE(colors.size(), count);
+        }
+    }
+
+    void benchmark_count_data()
+    {
+        palette_data();
+    }
+
+    /// Scanning only, as done for lazily loaded palettes
+    void benchmark_count()
+    {
+        QFETCH(QByteArray, data);
+        QFETCH(int, count);
+
+        QBENCHMARK
+        {
+            GplParser parser(data.constData(), data.size());
+            QVERIFY(parser.readHeader());
+            QCOMPARE(parser.countColors(), count);
+        }
+    }
+
+    void benchmark_load_data()
+    {
+        palette_data();
+    }
+
+    /// ColorPalette::load() on a mapped file
+    void benchmark_load()
+    {
+        QFETCH(QByteArray, data);
+        QFETCH(int, count);
+
+        QTemporaryDir dir;
+        QString file_name = dir.filePath(QStringLiteral("benchmark.gpl"));
+        QFile file(file_name);
+        QVERIFY(file.open(QFile::WriteOnly));
+        file.write(data);
+        file.close();
+
+        QBENCHMARK
+        {
+            ColorPalette palette;
+            QVERIFY(palette.load(file_name));
+            QCOMPARE(palette.count(), count);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchGplParser)
+#include "bench_gpl_parser.moc"
@@ -0,0 +1,110 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "QtColorWidgets/color_palette_model.hpp"
+
+using namespace color_widgets;
+
+static const int file_count = 5000;
+static const int color_count = 64;
+
+/**
+ * \brief Compares ColorPaletteModel::load() with and without the index cache
+ *
+ * The search path has 5k palettes of 64 colors, the cache is written by a
+ * first load outside of the measured loop.
+ */
+class BenchPaletteIndexCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+
+    static QByteArray palette(int index)
+    {
+        QByteArray data = "GIMP Palette\nName: Palette " + QByteArray::number(index) + "\nColumns: 8\n#\n";
+        for ( int i = 0; i < color_count; i++ )
+        {
+            int value = index * color_count + i;
+            data += QByteArray::number(value & 0xff) + ' ' + QByteArray::number((value >> 8) & 0xff) + ' ' +
+                    QByteArray::number((value * 37) & 0xff) + "\tColor " + QByteArray::number(i) + '\n';
+        }
+        return data;
+    }
+
+    QString searchPath() const
+    {
+        return QDir(dir.path()).absoluteFilePath(QStringLiteral("palettes"));
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(dir.isValid());
+        QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("palettes")));
+        QDir palettes(searchPath());
+        for ( int i = 0; i < file_count; i++ )
+        {
+            QFile file(palettes.absoluteFilePath(QStringLiteral("%1.gpl").arg(i, 5, 10, QLatin1Char('0'))));
+            QVERIFY(file.open(QFile::WriteOnly));
+            QVERIFY(file.write(palette(i)) > 0);
+        }
+    }
+
+    void benchmark_load_data()
+    {
+        QTest::addColumn<bool>("lazy");
+        QTest::addColumn<bool>("cache");
+        QTest::newRow("lazy") << true << false;
+        QTest::newRow("lazy cached") << true << true;
+        QTest::newRow("full") << false << false;
+        QTest::newRow("full cached") << false << true;
+    }
+
+    void benchmark_load()
+    {
+        QFETCH(bool, lazy);
+        QFETCH(bool, cache);
+
+        // Each row has its own cache, a lazy cache has no colors for the others
+        QString save_path = QDir(dir.path()).absoluteFilePath(QString::fromLatin1(QTest::currentDataTag()));
+        ColorPaletteModel model;
+        model.setSearchPaths(QStringList(searchPath()));
+        model.setSavePath(save_path);
+        model.setLazyLoading(lazy);
+        model.setIndexCache(cache);
+        model.load();
+        QCOMPARE(model.count(), file_count);
+
+        QBENCHMARK {
+            model.load();
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchPaletteIndexCache)
+#include "bench_palette_index_cache.moc"
@@ -0,0 +1,240 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <random>
+
+#include "QtColorWidgets/binary_palette_private.hpp"
+#include "QtColorWidgets/color_palette.hpp"
+
+using namespace color_widgets;
+
+class TestBinaryPalette : public QObject
+{
+    Q_OBJECT
+
+private:
+    typedef QVector<QPair<QColor, QString>> Colors;
+
+    /// Colors with and without names, one of them transparent and one named in UTF-8
+    static Colors sampleColors()
+    {
+        Colors colors;
+        colors.push_back(qMakePair(QColor(255, 0, 0), QStringLiteral("Red")));
+        colors.push_back(qMakePair(QColor(0, 128, 255, 64), QString()));
+        colors.push_back(qMakePair(QColor(1, 2, 3), QString::fromUtf8("Gr\xc3\xbcn")));
+        return colors;
+    }
+
+    static QByteArray sample()
+    {
+        return binary_palette::write(QStringLiteral("Sample"), 4, sampleColors());
+    }
+
+    static void write32(QByteArray& data, int offset, quint32 value)
+    {
+        qToLittleEndian(value, reinterpret_cast<uchar*>(data.data() + offset));
+    }
+
+    /// Offset of the name offsets in \p data
+    static int namesOffset(const QByteArray& data)
+    {
+        quint32 count = binary_palette::read32(data.constData() + 12);
+        quint32 name_size = binary_palette::read32(data.constData() + 16);
+        return int(binary_palette::header_size + binary_palette::padded(name_size) + count * 4);
+    }
+
+    static bool opens(const QByteArray& data)
+    {
+        binary_palette::View view;
+        return view.open(data.constData(), data.size());
+    }
+
+    static QByteArray fileStart(const QString& file_name)
+    {
+        QFile file(file_name);
+        if ( !file.open(QFile::ReadOnly) )
+            return QByteArray();
+        return file.read(12);
+    }
+
+private Q_SLOTS:
+    void test_round_trip()
+    {
+        Colors colors = sampleColors();
+        QByteArray data = sample();
+
+        binary_palette::View view;
+        QVERIFY(view.open(data.constData(), data.size()));
+        QCOMPARE(view.name(), QStringLiteral("Sample"));
+        QCOMPARE(view.columns(), 4);
+        QCOMPARE(view.count(), colors.size());
+
+        const QRgb* rgba = view.colors();
+        for ( int i = 0; i < colors.size(); i++ )
+        {
+            QCOMPARE(rgba[i], colors[i].first.rgba());
+            int size;
+            const char* name = view.colorName(i, size);
+            QCOMPARE(QString::fromUtf8(name, size), colors[i].second);
+        }
+    }
+
+    void test_round_trip_empty()
+    {
+        QByteArray data = binary_palette::write(QString(), 0, Colors());
+        binary_palette::View view;
+        QVERIFY(view.open(data.constData(), data.size()));
+        QCOMPARE(view.name(), QString());
+        QCOMPARE(view.count(), 0);
+    }
+
+    void test_truncated()
+    {
+        QByteArray data = sample();
+        for ( int size = 0; size < data.size(); size++ )
+            QVERIFY2(!opens(data.left(size)), qPrintable(QStringLiteral("size %1").arg(size)));
+    }
+
+    void test_wrong_version()
+    {
+        QByteArray data = sample();
+        qToLittleEndian<quint16>(binary_palette::version + 1, reinterpret_cast<uchar*>(data.data() + 4));
+        QVERIFY(!opens(data));
+    }
+
+    void test_unsorted_offsets()
+    {
+        // Names are "Red", "" and "Grün" so the offsets are 0, 3, 3, 8
+        QByteArray data = sample();
+        write32(data, namesOffset(data) + 4, 8);
+        QVERIFY(!opens(data));
+    }
+
+    void test_offset_out_of_range()
+    {
+        QByteArray data = sample();
+        quint32 strings_size = binary_palette::read32(data.constData() + 20);
+        write32(data, namesOffset(data) + 3 * 4, strings_size + 1);
+        QVERIFY(!opens(data));
+    }
+
+    void test_invalid_count()
+    {
+        QByteArray data = sample();
+        write32(data, 12, 0x80000000u);
+        QVERIFY(!opens(data));
+        write32(data, 12, 0xffffffffu);
+        QVERIFY(!opens(data));
+    }
+
+    /// Flips bits and overwrites bytes at random, whatever opens must stay in bounds
+    void test_fuzz()
+    {
+        const QByteArray original = sample();
+        std::mt19937 random(20201);
+        int opened = 0;
+        for ( int run = 0; run < 20000; run++ )
+        {
+            QByteArray data = original;
+            int edits = 1 + int(random() % 4);
+            for ( int i = 0; i < edits; i++ )
+            {
+                int pos = int(random() % quint32(data.size()));
+                if ( random() % 2 )
+                    data[pos] = char(data[pos] ^ (1 << (random() % 8)));
+                else
+                    data[pos] = char(random());
+            }
+
+            binary_palette::View view;
+            if ( !view.open(data.constData(), data.size()) )
+                continue;
+
+            opened++;
+            const char* begin = data.constData();
+            const char* end = begin + data.size();
+            QVERIFY(view.count() >= 0);
+            QVERIFY(qint64(view.count()) * 8 <= data.size());
+
+            // Reads every color and name so sanitizers catch overruns
+            const QRgb* colors = view.colors();
+            QRgb all_colors = 0;
+            for ( int i = 0; i < view.count(); i++ )
+            {
+                all_colors |= colors[i];
+                int size;
+                const char* name = view.colorName(i, size);
+                QVERIFY2(size >= 0 && name >= begin && name + size <= end,
+                         qPrintable(QStringLiteral("run %1 color %2").arg(run).arg(i)));
+            }
+            Q_UNUSED(all_colors);
+        }
+
+        // Mutations of unused bytes and colors still open, so both paths are covered
+        QVERIFY(opened > 0);
+    }
+
+    void test_save_format()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        ColorPalette palette(sampleColors(), QStringLiteral("Sample"), 4);
+
+        QString binary_name = dir.filePath(QStringLiteral("sample.qpal"));
+        QVERIFY(palette.save(binary_name));
+        QVERIFY(fileStart(binary_name).startsWith("QCPL"));
+
+        ColorPalette loaded;
+        QVERIFY(loaded.load(binary_name));
+        QCOMPARE(loaded.name(), QStringLiteral("Sample"));
+        QCOMPARE(loaded.columns(), 4);
+        QCOMPARE(loaded.colors(), sampleColors());
+
+        // Saving in place keeps the format of the loaded file
+        loaded.appendColor(QColor(4, 5, 6), QStringLiteral("New"));
+        QVERIFY(loaded.save());
+        QVERIFY(fileStart(binary_name).startsWith("QCPL"));
+
+        // The extension picks the format, regardless of case
+        QString upper_name = dir.filePath(QStringLiteral("upper.QPAL"));
+        QVERIFY(palette.save(upper_name));
+        QVERIFY(fileStart(upper_name).startsWith("QCPL"));
+
+        QString gpl_name = dir.filePath(QStringLiteral("sample.gpl"));
+        QVERIFY(loaded.save(gpl_name));
+        QVERIFY(fileStart(gpl_name).startsWith("GIMP Palette"));
+
+        ColorPalette gpl;
+        QVERIFY(gpl.load(gpl_name));
+        QCOMPARE(gpl.count(), loaded.count());
+        QCOMPARE(gpl.colorAt(0), QColor(255, 0, 0));
+        QVERIFY(gpl.save());
+        QVERIFY(fileStart(gpl_name).startsWith("GIMP Palette"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBinaryPalette)
+#include "test_binary_palette.moc"
@@ -0,0 +1,124 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <vector>
+
+#include "QtColorWidgets/color_utils.hpp"
+
+using namespace color_widgets;
+
+class TestFixedPointHsv : public QObject
+{
+    Q_OBJECT
+
+private:
+    /// Every opaque 8-bit color with the given red channel
+    static std::vector<QRgb> plane(int red)
+    {
+        std::vector<QRgb> colors(256 * 256);
+        for ( int i = 0; i < 256 * 256; i++ )
+            colors[i] = qRgb(red, i >> 8, i & 0xff);
+        return colors;
+    }
+
+private Q_SLOTS:
+    void test_known_colors()
+    {
+        QCOMPARE(utils::rgb_from_hsv16(0, 65535, 65535), qRgb(255, 0, 0));
+        QCOMPARE(utils::rgb_from_hsv16(21845, 65535, 65535), qRgb(0, 255, 0));
+        QCOMPARE(utils::rgb_from_hsv16(43690, 65535, 65535), qRgb(0, 0, 255));
+        QCOMPARE(utils::rgb_from_hsv16(12345, 0, 65535), qRgb(255, 255, 255));
+        QCOMPARE(utils::rgb_from_hsl16(0, 65535, 32768), qRgb(255, 0, 0));
+        QCOMPARE(utils::rgb_from_hsl16(12345, 65535, 0), qRgb(0, 0, 0));
+
+        quint16 hue, sat, val;
+        utils::rgb_to_hsv16(qRgb(128, 128, 128), hue, sat, val);
+        QCOMPARE(int(hue), 0);
+        QCOMPARE(int(sat), 0);
+        QCOMPARE(int(val), 128 * 257);
+    }
+
+    void test_round_trip_hsv()
+    {
+        for ( int red = 0; red < 256; red++ )
+        {
+            for ( QRgb color : plane(red) )
+            {
+                quint16 hue, sat, val;
+                utils::rgb_to_hsv16(color, hue, sat, val);
+                if ( utils::rgb_from_hsv16(hue, sat, val) != color )
+                    QFAIL(qPrintable(QString::number(color, 16)));
+            }
+        }
+    }
+
+    void test_round_trip_hsl()
+    {
+        for ( int red = 0; red < 256; red++ )
+        {
+            for ( QRgb color : plane(red) )
+            {
+                quint16 hue, sat, lig;
+                utils::rgb_to_hsl16(color, hue, sat, lig);
+                if ( utils::rgb_from_hsl16(hue, sat, lig) != color )
+                    QFAIL(qPrintable(QString::number(color, 16)));
+            }
+        }
+    }
+
+    void test_round_trip_batch_data()
+    {
+        QTest::addColumn<int>("space");
+        QTest::newRow("hsv") << int(utils::BatchColorSpace::HSV);
+        QTest::newRow("hsl") << int(utils::BatchColorSpace::HSL);
+    }
+
+    void test_round_trip_batch()
+    {
+        QFETCH(int, space);
+        std::vector<quint16> components(256 * 256 * 3);
+        std::vector<QRgb> result(256 * 256);
+        for ( int red = 0; red < 256; red++ )
+        {
+            std::vector<QRgb> colors = plane(red);
+            int count = int(colors.size());
+            QVERIFY(utils::convert_from_rgb(utils::BatchColorSpace(space), colors.data(), components.data(), count));
+            QVERIFY(utils::convert_to_rgb(utils::BatchColorSpace(space), components.data(), result.data(), count));
+            QVERIFY(result == colors);
+        }
+    }
+
+    void test_unsupported_space()
+    {
+        QRgb color = qRgb(10, 20, 30);
+        quint16 components[3] = {1, 2, 3};
+        QVERIFY(!utils::convert_from_rgb(utils::BatchColorSpace::OKLab, &color, components, 1));
+        QCOMPARE(int(components[0]), 1);
+        QCOMPARE(int(components[2]), 3);
+
+        QVERIFY(!utils::convert_to_rgb(utils::BatchColorSpace::LCH, components, &color, 1));
+        QCOMPARE(color, qRgb(10, 20, 30));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestFixedPointHsv)
+#include "test_fixed_point_hsv.moc"
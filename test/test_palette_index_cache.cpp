@@ -0,0 +1,403 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "QtColorWidgets/color_palette.hpp"
+#include "QtColorWidgets/color_palette_model.hpp"
+
+using namespace color_widgets;
+
+static const int file_count = 5;
+
+/**
+ * \brief Tests ColorPaletteModel::indexCache
+ *
+ * To tell which palettes come from the cache, files are replaced by a
+ * variant with different colors but the same size and modification time:
+ * palettes restored from the cache keep the colors of the original file,
+ * palettes read again show the variant.
+ */
+class TestPaletteIndexCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    typedef QVector<QPair<QColor, QString>> Colors;
+
+    /// Cache entry, in the same format as PaletteIndexCache
+    struct CacheItem
+    {
+        QString key;
+        qint64 size = 0;
+        qint64 modified = 0;
+        QString name;
+        qint32 columns = 0;
+        qint32 count = 0;
+        bool binary = false;
+        QByteArray body;
+    };
+
+    struct Cache
+    {
+        quint32 magic = 0;
+        quint32 version = 0;
+        QList<CacheItem> items;
+    };
+
+    QScopedPointer<QTemporaryDir> dir;
+
+    static QString paletteName(int index)
+    {
+        return QStringLiteral("Palette %1").arg(index, 4, 10, QLatin1Char('0'));
+    }
+
+    /// Colors of a palette, variants have the same number of digits
+    static Colors colors(int index, int variant, int count = 4)
+    {
+        Colors result;
+        for ( int i = 0; i < count; i++ )
+        {
+            int value = 100 + (index * 31 + variant * 17 + i * 7) % 150;
+            result.push_back(qMakePair(QColor(value, 255 - value, i * 50 + 10),
+                                       QStringLiteral("Color %1").arg(i)));
+        }
+        return result;
+    }
+
+    static QByteArray gpl(int index, int variant, int count = 4)
+    {
+        QByteArray data = "GIMP Palette\nName: " + paletteName(index).toUtf8() + "\nColumns: 2\n#\n";
+        for ( const auto& color : colors(index, variant, count) )
+        {
+            data += QStringLiteral("%1 %2 %3\t")
+                .arg(color.first.red(), 3).arg(color.first.green(), 3).arg(color.first.blue(), 3)
+                .toUtf8();
+            data += color.second.toUtf8() + '\n';
+        }
+        return data;
+    }
+
+    static QString describe(const QString& name, const Colors& palette_colors)
+    {
+        QStringList parts(name);
+        for ( const auto& color : palette_colors )
+            parts << color.first.name(QColor::HexArgb) + QLatin1Char(' ') + color.second;
+        return parts.join(QStringLiteral(", "));
+    }
+
+    /// Palettes expected from files with the given variants
+    static QStringList expected(const QVector<int>& variants)
+    {
+        QStringList result;
+        for ( int i = 0; i < variants.size(); i++ )
+            result << describe(paletteName(i), colors(i, variants[i]));
+        return result;
+    }
+
+    static QStringList originals()
+    {
+        return expected(QVector<int>(file_count, 0));
+    }
+
+    static QStringList snapshot(const ColorPaletteModel& model)
+    {
+        QStringList result;
+        for ( int i = 0; i < model.count(); i++ )
+        {
+            const ColorPalette& palette = model.palette(i);
+            result << describe(palette.name(), palette.colors());
+        }
+        return result;
+    }
+
+    QString palettePath(int index) const
+    {
+        return QDir(dir->path()).absoluteFilePath(QStringLiteral("palettes/%1.gpl").arg(index));
+    }
+
+    QString cachePath() const
+    {
+        return QDir(dir->path()).absoluteFilePath(QStringLiteral("cache"));
+    }
+
+    QString cacheFile() const
+    {
+        return QDir(cachePath()).absoluteFilePath(QStringLiteral("palettes.cache"));
+    }
+
+    static bool writeFile(const QString& file_name, const QByteArray& data)
+    {
+        QFile file(file_name);
+        return file.open(QFile::WriteOnly|QFile::Truncate) && file.write(data) == data.size();
+    }
+
+    static QByteArray readFile(const QString& file_name)
+    {
+        QFile file(file_name);
+        if ( !file.open(QFile::ReadOnly) )
+            return QByteArray();
+        return file.readAll();
+    }
+
+    /// Replaces the contents of \p file_name, setting its modification time to \p modified
+    static bool rewrite(const QString& file_name, const QByteArray& data, const QDateTime& modified)
+    {
+        QFile file(file_name);
+        if ( !file.open(QFile::WriteOnly|QFile::Truncate) || file.write(data) != data.size() )
+            return false;
+        // Flushed first, so closing the file doesn't change the time again
+        return file.flush() && file.setFileTime(modified, QFileDevice::FileModificationTime);
+    }
+
+    /// Replaces a file with a variant with the same size and modification time
+    static bool poison(const QString& file_name, int index)
+    {
+        return rewrite(file_name, gpl(index, 1), QFileInfo(file_name).lastModified());
+    }
+
+    QStringList load(bool lazy = false)
+    {
+        ColorPaletteModel model;
+        model.setSearchPaths(QStringList(QDir(dir->path()).absoluteFilePath(QStringLiteral("palettes"))));
+        model.setSavePath(cachePath());
+        model.setIndexCache(true);
+        model.setLazyLoading(lazy);
+        model.load();
+        return snapshot(model);
+    }
+
+    static Cache readCache(const QString& file_name)
+    {
+        Cache cache;
+        QFile file(file_name);
+        if ( !file.open(QFile::ReadOnly) )
+            return cache;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        quint32 size = 0;
+        stream >> cache.magic >> cache.version >> size;
+        for ( quint32 i = 0; i < size && stream.status() == QDataStream::Ok; i++ )
+        {
+            CacheItem item;
+            stream >> item.key >> item.size >> item.modified >> item.name >> item.columns >> item.count
+                   >> item.binary >> item.body;
+            cache.items.push_back(item);
+        }
+        return cache;
+    }
+
+    static bool writeCache(const QString& file_name, const Cache& cache)
+    {
+        QFile file(file_name);
+        if ( !file.open(QFile::WriteOnly|QFile::Truncate) )
+            return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << cache.magic << cache.version << quint32(cache.items.size());
+        for ( const CacheItem& item : cache.items )
+            stream << item.key << item.size << item.modified << item.name << item.columns << item.count
+                   << item.binary << item.body;
+        return stream.status() == QDataStream::Ok;
+    }
+
+private Q_SLOTS:
+    void init()
+    {
+        dir.reset(new QTemporaryDir);
+        QVERIFY(dir->isValid());
+        QVERIFY(QDir(dir->path()).mkdir(QStringLiteral("palettes")));
+        for ( int i = 0; i < file_count; i++ )
+            QVERIFY(writeFile(palettePath(i), gpl(i, 0)));
+    }
+
+    void test_second_load_data()
+    {
+        QTest::addColumn<bool>("lazy");
+        QTest::newRow("lazy") << true;
+        QTest::newRow("not lazy") << false;
+    }
+
+    void test_second_load()
+    {
+        QFETCH(bool, lazy);
+
+        QCOMPARE(load(lazy), originals());
+        QVERIFY(QFile::exists(cacheFile()));
+        QByteArray cache = readFile(cacheFile());
+
+        QCOMPARE(load(lazy), originals());
+        // Nothing changed, so the cache isn't written again
+        QCOMPARE(readFile(cacheFile()), cache);
+    }
+
+    void test_version()
+    {
+        load();
+        Cache cache = readCache(cacheFile());
+        QCOMPARE(cache.magic, quint32(0x51435049));
+        QCOMPARE(cache.version, quint32(2));
+        QCOMPARE(cache.items.size(), file_count);
+        for ( const CacheItem& item : cache.items )
+            QVERIFY(!item.body.isEmpty());
+    }
+
+    void test_restore_colors()
+    {
+        load();
+        for ( int i = 0; i < file_count; i++ )
+            QVERIFY(poison(palettePath(i), i));
+
+        // Without lazy loading all the colors come from the cache
+        QCOMPARE(load(), originals());
+    }
+
+    void test_touched_file_data()
+    {
+        QTest::addColumn<bool>("same_size");
+        QTest::addColumn<bool>("same_time");
+        QTest::newRow("size") << false << true;
+        QTest::newRow("time") << true << false;
+        QTest::newRow("size and time") << false << false;
+    }
+
+    void test_touched_file()
+    {
+        QFETCH(bool, same_size);
+        QFETCH(bool, same_time);
+        const int touched = 2;
+
+        load();
+        for ( int i = 0; i < file_count; i++ )
+            if ( i != touched )
+                QVERIFY(poison(palettePath(i), i));
+
+        QDateTime modified = QFileInfo(palettePath(touched)).lastModified();
+        if ( !same_time )
+            modified = modified.addSecs(10);
+        QByteArray data = gpl(touched, 1, same_size ? 4 : 5);
+        QCOMPARE(data.size() == QFileInfo(palettePath(touched)).size(), same_size);
+        QVERIFY(rewrite(palettePath(touched), data, modified));
+
+        QStringList palettes = originals();
+        palettes[touched] = describe(paletteName(touched), colors(touched, 1, same_size ? 4 : 5));
+        QCOMPARE(load(), palettes);
+
+        // The cache has been updated with the new file
+        QCOMPARE(load(), palettes);
+    }
+
+    void test_removed_file()
+    {
+        load();
+        QVERIFY(QFile::remove(palettePath(file_count - 1)));
+
+        QStringList palettes = originals();
+        palettes.removeLast();
+        QCOMPARE(load(), palettes);
+        QCOMPARE(readCache(cacheFile()).items.size(), file_count - 1);
+    }
+
+    void test_lazy_cache_not_lazy_load()
+    {
+        load(true);
+        for ( const CacheItem& item : readCache(cacheFile()).items )
+            QVERIFY(item.body.isEmpty());
+        for ( int i = 0; i < file_count; i++ )
+            QVERIFY(poison(palettePath(i), i));
+
+        // The cache has no colors, so the files are read again
+        QStringList variants = expected(QVector<int>(file_count, 1));
+        QCOMPARE(load(), variants);
+        for ( const CacheItem& item : readCache(cacheFile()).items )
+            QVERIFY(!item.body.isEmpty());
+    }
+
+    void test_corrupt_body()
+    {
+        load();
+        Cache cache = readCache(cacheFile());
+        QCOMPARE(cache.items.size(), file_count);
+        for ( CacheItem& item : cache.items )
+            item.body.truncate(item.body.size() / 2);
+        QVERIFY(writeCache(cacheFile(), cache));
+        for ( int i = 0; i < file_count; i++ )
+            QVERIFY(poison(palettePath(i), i));
+
+        // Bodies that can't be decoded fall back to reading the file
+        QCOMPARE(load(), expected(QVector<int>(file_count, 1)));
+    }
+
+    void test_corrupt_cache_data()
+    {
+        QTest::addColumn<int>("corruption");
+        QTest::newRow("empty") << 0;
+        QTest::newRow("garbage") << 1;
+        QTest::newRow("truncated") << 2;
+        QTest::newRow("old version") << 3;
+    }
+
+    void test_corrupt_cache()
+    {
+        QFETCH(int, corruption);
+
+        load();
+        QByteArray cache = readFile(cacheFile());
+        QVERIFY(cache.size() > 12);
+        switch ( corruption )
+        {
+            case 0:
+                cache.clear();
+                break;
+            case 1:
+                for ( int i = 0; i < cache.size(); i++ )
+                    cache[i] = char(i * 131 + 7);
+                break;
+            case 2:
+                cache.truncate(cache.size() - 3);
+                break;
+            case 3:
+                // QDataStream is big endian, this is the last byte of the version
+                cache[7] = 1;
+                break;
+        }
+        QVERIFY(writeFile(cacheFile(), cache));
+        for ( int i = 0; i < file_count; i++ )
+            QVERIFY(poison(palettePath(i), i));
+
+        // The cache is ignored and all the files are read again
+        QStringList variants = expected(QVector<int>(file_count, 1));
+        QCOMPARE(load(), variants);
+        QCOMPARE(readCache(cacheFile()).items.size(), file_count);
+        QCOMPARE(load(), variants);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPaletteIndexCache)
+#include "test_palette_index_cache.moc"
@@ -0,0 +1,84 @@
+/**
+ * \file
+ *
+ * \author Mattia Basaglia
+ *
+ * \copyright Copyright (C) 2013-2020 Mattia Basaglia
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <QtTest>
+#include <cstring>
+
+#include "QtColorWidgets/srgb_tables_private.hpp"
+
+using namespace color_widgets::utils;
+
+class TestSrgbTables : public QObject
+{
+    Q_OBJECT
+
+private:
+    /// Distance between \p a and \p b in units in the last place, both must be positive
+    static qint64 ulps(float a, float b)
+    {
+        qint32 ia, ib;
+        std::memcpy(&ia, &a, sizeof(a));
+        std::memcpy(&ib, &b, sizeof(b));
+        return qAbs(qint64(ia) - qint64(ib));
+    }
+
+private Q_SLOTS:
+    void test_decode_table()
+    {
+        for ( int i = 0; i < 256; i++ )
+        {
+            float expected = float(srgb_decode(i / 255.0));
+            QVERIFY2(ulps(srgb_decode_byte(i), expected) <= 1, qPrintable(QString::number(i)));
+        }
+    }
+
+    void test_encode_table()
+    {
+        const int size = srgb_tables::encode_steps + 2;
+        for ( int i = 0; i < size; i++ )
+        {
+            float expected = float(srgb_encode(double(i) / srgb_tables::encode_steps));
+            float actual = srgb_tables::Encode12::values[i];
+            QVERIFY2(ulps(actual, expected) <= 1, qPrintable(QString::number(i)));
+        }
+    }
+
+    void test_encode_interpolation()
+    {
+        for ( int i = 0; i <= 65535; i++ )
+        {
+            float linear = i / 65535.f;
+            QVERIFY(qAbs(srgb_encode_fast(linear) - srgb_encode(linear)) < 2e-5f);
+        }
+
+        QCOMPARE(srgb_encode_fast(-1.f), 0.f);
+        QVERIFY(qAbs(srgb_encode_fast(2.f) - 1.f) < 2e-5f);
+    }
+
+    void test_round_trip()
+    {
+        for ( int i = 0; i < 256; i++ )
+            QCOMPARE(qRound(srgb_encode_fast(srgb_decode_byte(i)) * 255), i);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSrgbTables)
+#include "test_srgb_tables.moc"